@@ -0,0 +1,605 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "corpus.h"
+#include "data.h"
+#include "ipconfig.h"
+#include "error.h"
+
+struct IPConfigBenchmarkCorpus
+{
+	uint32_t version;
+
+	char *packed;
+	size_t packedSize;
+
+	char *unpacked;
+	size_t unpackedSize;
+
+	struct IPConfig *configs;
+	size_t configCount;
+};
+
+struct IPConfigBenchmark
+{
+	const char *name;
+	const char *unit;
+	double (*run)(struct IPConfigBenchmark *benchmark);
+
+	size_t bytes;
+	size_t items;
+
+	struct IPConfigBenchmarkCorpus *corpus;
+	char *data;
+	size_t size;
+	struct IPConfigString *strings;
+	size_t stringCount;
+	struct IPConfigArena arena;
+	FILE *sink;
+};
+
+static void usage(FILE *stream)
+{
+	fprintf(stream, "usage: benchmark [-i SAMPLES] [CORPUS OPTIONS]\n");
+	fprintf(stream, "\n");
+	fprintf(stream, "Options:\n");
+	fprintf(stream, "  -i SAMPLES    Samples taken per benchmark\n");
+	fprintf(stream, "\n");
+	printIPConfigCorpusUsage(stream);
+}
+
+static double getTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static int compareSamples(const void *left, const void *right)
+{
+	double difference = *(const double *) left - *(const double *) right;
+	return (difference > 0) - (difference < 0);
+}
+
+static bool runBenchmark(struct IPConfigBenchmark *benchmark,
+                         size_t sampleCount)
+{
+	double *samples = calloc(sampleCount, sizeof *samples);
+	double total = 0;
+
+	if (!samples)
+	{
+		printLibraryError("calloc");
+		return false;
+	}
+
+	benchmark->run(benchmark);
+
+	for (size_t index = 0; index < sampleCount; index++)
+	{
+		samples[index] = benchmark->run(benchmark);
+
+		if (samples[index] < 0)
+		{
+			printError(benchmark->name);
+			free(samples);
+			return false;
+		}
+
+		total += samples[index];
+	}
+
+	qsort(samples, sampleCount, sizeof *samples, compareSamples);
+
+	printf("%-34s %10.1f MB/s %12.0f %s/s  p50 %9.1f ns  p99 %9.1f ns\n",
+	       benchmark->name,
+	       benchmark->bytes * sampleCount / total * 1e3,
+	       benchmark->items * sampleCount / total * 1e9,
+	       benchmark->unit,
+	       samples[sampleCount / 2] / benchmark->items,
+	       samples[sampleCount * 99 / 100] / benchmark->items);
+
+	free(samples);
+	return true;
+}
+
+static double runReadPackedString(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigInput input;
+	struct IPConfigString string;
+	double start = getTime();
+
+	initializeBufferIPConfigInput(&input, benchmark->data, benchmark->size);
+
+	for (size_t index = 0; index < benchmark->items; index++)
+	{
+		if (!readPackedString(&input, &string))
+		{
+			return -1;
+		}
+	}
+
+	return getTime() - start;
+}
+
+static double runReadPackedStreamString(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigInput input;
+	struct IPConfigString string;
+	FILE *stream = fmemopen(benchmark->data, benchmark->size, "r");
+	double start = getTime();
+
+	if (!stream)
+	{
+		return -1;
+	}
+
+	initializeStreamIPConfigInput(&input, stream);
+	input.arena = &benchmark->arena;
+	resetIPConfigArena(&benchmark->arena);
+
+	for (size_t index = 0; index < benchmark->items; index++)
+	{
+		if (!readPackedString(&input, &string))
+		{
+			fclose(stream);
+			return -1;
+		}
+	}
+
+	start = getTime() - start;
+	fclose(stream);
+
+	return start;
+}
+
+static double runParseUnpackedLink(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigLink link;
+	double start = getTime();
+
+	resetIPConfigArena(&benchmark->arena);
+
+	for (size_t index = 0; index < benchmark->items; index++)
+	{
+		char *string = (char *) benchmark->strings[index].data;
+
+		if (!parseUnpackedLink(string, &benchmark->arena, &link))
+		{
+			return -1;
+		}
+	}
+
+	return getTime() - start;
+}
+
+static double runGetAttributeType(struct IPConfigBenchmark *benchmark)
+{
+	uint32_t version = benchmark->corpus->version;
+	double start = getTime();
+
+	for (size_t index = 0; index < benchmark->items; index++)
+	{
+		struct IPConfigString *key = &benchmark->strings[index %
+		                                benchmark->stringCount];
+
+		if (getIPConfigAttributeType(version, key) ==
+		    InvalidIPConfigAttributeType)
+		{
+			return -1;
+		}
+	}
+
+	return getTime() - start;
+}
+
+static double runReadPackedIPConfig(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigBenchmarkCorpus *corpus = benchmark->corpus;
+	struct IPConfigReader reader;
+	struct IPConfig config = {0};
+	size_t count = 0;
+	double start = getTime();
+
+	if (!initializeBufferIPConfigReader(&reader, corpus->packed,
+	                                    corpus->packedSize))
+	{
+		return -1;
+	}
+
+	while (readIPConfigRecord(&reader, &config) == ReadIPConfigRecordStatus)
+	{
+		resetIPConfig(&config);
+		count++;
+	}
+
+	start = getTime() - start;
+	deinitializeIPConfig(&config);
+
+	return count == corpus->configCount ? start : -1;
+}
+
+static double runReadPackedStreamIPConfig(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigBenchmarkCorpus *corpus = benchmark->corpus;
+	struct IPConfigReader reader;
+	struct IPConfig config = {0};
+	size_t count = 0;
+	FILE *stream = fmemopen(corpus->packed, corpus->packedSize, "r");
+	double start = getTime();
+
+	if (!stream)
+	{
+		return -1;
+	}
+
+	if (initializePackedIPConfigReader(&reader, stream))
+	{
+		while (readIPConfigRecord(&reader, &config) ==
+		       ReadIPConfigRecordStatus)
+		{
+			resetIPConfig(&config);
+			count++;
+		}
+	}
+
+	start = getTime() - start;
+	deinitializeIPConfig(&config);
+	fclose(stream);
+
+	return count == corpus->configCount ? start : -1;
+}
+
+static double runReadUnpackedIPConfig(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigBenchmarkCorpus *corpus = benchmark->corpus;
+	struct IPConfigReader reader;
+	struct IPConfig config = {0};
+	size_t count = 0;
+	FILE *stream = fmemopen(corpus->unpacked, corpus->unpackedSize, "r");
+	double start = getTime();
+
+	if (!stream)
+	{
+		return -1;
+	}
+
+	if (initializeUnpackedIPConfigReader(&reader, stream, corpus->version))
+	{
+		while (readIPConfigRecord(&reader, &config) ==
+		       ReadIPConfigRecordStatus)
+		{
+			resetIPConfig(&config);
+			count++;
+		}
+	}
+
+	start = getTime() - start;
+	deinitializeIPConfigReader(&reader);
+	deinitializeIPConfig(&config);
+	fclose(stream);
+
+	return count == corpus->configCount ? start : -1;
+}
+
+static double runWriteUnpackedIPConfig(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigBenchmarkCorpus *corpus = benchmark->corpus;
+	double start = getTime();
+
+	for (size_t index = 0; index < corpus->configCount; index++)
+	{
+		if (!writeUnpackedIPConfig(&corpus->configs[index],
+		                           benchmark->sink))
+		{
+			return -1;
+		}
+	}
+
+	fflush(benchmark->sink);
+	return getTime() - start;
+}
+
+static double runEncodePackedIPConfig(struct IPConfigBenchmark *benchmark)
+{
+	struct IPConfigBenchmarkCorpus *corpus = benchmark->corpus;
+	unsigned char *cursor = (unsigned char *) benchmark->data;
+	double start = getTime();
+
+	for (size_t index = 0; index < corpus->configCount; index++)
+	{
+		cursor += encodePackedIPConfigRecord(&corpus->configs[index],
+		                                     cursor);
+	}
+
+	return getTime() - start;
+}
+
+static bool generateCorpus(struct IPConfigCorpusOptions *options,
+                           uint32_t version,
+                           struct IPConfigBenchmarkCorpus *corpus)
+{
+	struct IPConfigCorpusOptions textOptions = *options;
+	struct IPConfigReader reader;
+	FILE *stream = NULL;
+	bool generated = false;
+
+	corpus->version = version;
+
+	if (!(stream = open_memstream(&corpus->unpacked,
+	                              &corpus->unpackedSize)))
+	{
+		printLibraryError("open_memstream");
+		return false;
+	}
+
+	generated = generateUnpackedIPConfigCorpus(&textOptions, version,
+	                                           stream);
+
+	if (fclose(stream) == EOF || !generated)
+	{
+		return false;
+	}
+
+	if (!(stream = open_memstream(&corpus->packed, &corpus->packedSize)))
+	{
+		printLibraryError("open_memstream");
+		return false;
+	}
+
+	generated = generatePackedIPConfigCorpus(options, version, stream);
+
+	if (fclose(stream) == EOF || !generated)
+	{
+		return false;
+	}
+
+	corpus->configs = calloc(options->recordCount, sizeof *corpus->configs);
+
+	if (!corpus->configs)
+	{
+		printLibraryError("calloc");
+		return false;
+	}
+
+	if (!initializeBufferIPConfigReader(&reader, corpus->packed,
+	                                    corpus->packedSize))
+	{
+		return false;
+	}
+
+	while (corpus->configCount < options->recordCount &&
+	       readIPConfigRecord(&reader, &corpus->configs[corpus->configCount])
+	       == ReadIPConfigRecordStatus)
+	{
+		corpus->configCount++;
+	}
+
+	return corpus->configCount == options->recordCount;
+}
+
+static void deinitializeCorpus(struct IPConfigBenchmarkCorpus *corpus)
+{
+	for (size_t index = 0; index < corpus->configCount; index++)
+	{
+		deinitializeIPConfig(&corpus->configs[index]);
+	}
+
+	free(corpus->configs);
+	free(corpus->packed);
+	free(corpus->unpacked);
+}
+
+static bool runCorpusBenchmarks(struct IPConfigCorpusOptions *options,
+                                uint32_t version, size_t sampleCount)
+{
+	static const char *keys[] =
+	{
+		"id", "ipAssignment", "linkAddress", "gateway", "dns",
+		"proxySettings", "proxyHost", "proxyPort", "proxyPac",
+		"exclusionList", "eos"
+	};
+
+	struct IPConfigBenchmarkCorpus corpus = {0};
+	struct IPConfigBenchmark benchmark = {0};
+	struct IPConfigString keyStrings[sizeof keys / sizeof *keys];
+	char name[64];
+	bool succeeded = false;
+
+	if (!generateCorpus(options, version, &corpus))
+	{
+		printError("failed to generate corpus");
+		deinitializeCorpus(&corpus);
+		return false;
+	}
+
+	benchmark.corpus = &corpus;
+	benchmark.name = name;
+	benchmark.unit = "records";
+	benchmark.items = corpus.configCount;
+
+	snprintf(name, sizeof name, "readPackedIPConfig/v%" PRIu32, version);
+	benchmark.run = runReadPackedIPConfig;
+	benchmark.bytes = corpus.packedSize;
+	succeeded = runBenchmark(&benchmark, sampleCount);
+
+	snprintf(name, sizeof name, "readPackedIPConfig/stream/v%" PRIu32,
+	         version);
+	benchmark.run = runReadPackedStreamIPConfig;
+	succeeded = succeeded && runBenchmark(&benchmark, sampleCount);
+
+	snprintf(name, sizeof name, "encodePackedIPConfig/v%" PRIu32, version);
+	benchmark.run = runEncodePackedIPConfig;
+	benchmark.data = malloc(corpus.packedSize);
+	succeeded = succeeded && benchmark.data &&
+	            runBenchmark(&benchmark, sampleCount);
+	free(benchmark.data);
+
+	snprintf(name, sizeof name, "readUnpackedIPConfig/v%" PRIu32, version);
+	benchmark.run = runReadUnpackedIPConfig;
+	benchmark.bytes = corpus.unpackedSize;
+	succeeded = succeeded && runBenchmark(&benchmark, sampleCount);
+
+	snprintf(name, sizeof name, "writeUnpackedIPConfig/v%" PRIu32, version);
+	benchmark.run = runWriteUnpackedIPConfig;
+	benchmark.sink = fopen("/dev/null", "w");
+	succeeded = succeeded && benchmark.sink &&
+	            runBenchmark(&benchmark, sampleCount);
+
+	if (benchmark.sink)
+	{
+		fclose(benchmark.sink);
+	}
+
+	for (size_t index = 0; index < sizeof keys / sizeof *keys; index++)
+	{
+		keyStrings[index].data = keys[index];
+		keyStrings[index].length = strlen(keys[index]);
+	}
+
+	snprintf(name, sizeof name, "getAttributeType/v%" PRIu32, version);
+	benchmark.run = runGetAttributeType;
+	benchmark.unit = "calls";
+	benchmark.strings = keyStrings;
+	benchmark.stringCount = sizeof keys / sizeof *keys;
+	benchmark.items = 1 << 16;
+	benchmark.bytes = 0;
+
+	for (size_t index = 0; index < benchmark.items; index++)
+	{
+		benchmark.bytes += keyStrings[index % benchmark.stringCount].length;
+	}
+
+	succeeded = succeeded && runBenchmark(&benchmark, sampleCount);
+
+	deinitializeCorpus(&corpus);
+	return succeeded;
+}
+
+static bool runStringBenchmarks(struct IPConfigCorpusOptions *options,
+                                size_t sampleCount)
+{
+	struct IPConfigBenchmark benchmark = {0};
+	size_t count = 1 << 14;
+	size_t length = options->stringLength ? options->stringLength : 1;
+	unsigned char *cursor = NULL;
+	char *links = NULL;
+	bool succeeded = false;
+
+	benchmark.name = "readPackedString";
+	benchmark.unit = "calls";
+	benchmark.run = runReadPackedString;
+	benchmark.items = count;
+	benchmark.size = count * (sizeof(uint16_t) + length);
+	benchmark.bytes = benchmark.size;
+	benchmark.data = malloc(benchmark.size);
+	benchmark.strings = calloc(count, sizeof *benchmark.strings);
+	links = malloc(count * 20);
+
+	if (!benchmark.data || !benchmark.strings || !links)
+	{
+		printLibraryError("malloc");
+		free(benchmark.data);
+		free(benchmark.strings);
+		free(links);
+		return false;
+	}
+
+	cursor = (unsigned char *) benchmark.data;
+
+	for (size_t index = 0; index < count; index++)
+	{
+		memset(cursor + sizeof(uint16_t), 'a' + index % 26, length);
+		cursor = encodePackedUInt16(length, cursor) + length;
+	}
+
+	succeeded = runBenchmark(&benchmark, sampleCount);
+
+	benchmark.name = "readPackedString/stream";
+	benchmark.run = runReadPackedStreamString;
+	succeeded = succeeded && runBenchmark(&benchmark, sampleCount);
+
+	benchmark.name = "parseUnpackedLink";
+	benchmark.run = runParseUnpackedLink;
+	benchmark.bytes = 0;
+
+	for (size_t index = 0; index < count; index++)
+	{
+		char *link = links + index * 20;
+		int written = snprintf(link, 20, "10.%zu.%zu.%zu/24",
+		                       (index >> 16) & 0xff,
+		                       (index >> 8) & 0xff, index & 0xff);
+
+		benchmark.strings[index].data = link;
+		benchmark.strings[index].length = written;
+		benchmark.bytes += written;
+	}
+
+	succeeded = succeeded && runBenchmark(&benchmark, sampleCount);
+
+	deinitializeIPConfigArena(&benchmark.arena);
+	free(benchmark.data);
+	free(benchmark.strings);
+	free(links);
+
+	return succeeded;
+}
+
+int main(int argc, char *argv[])
+{
+	struct IPConfigCorpusOptions options;
+	unsigned long sampleCount = 100;
+	int option = 0;
+
+	setIPConfigErrorStream(stderr);
+	initializeIPConfigCorpusOptions(&options);
+
+	while ((option = getopt(argc, argv,
+	                        "hi:" IPConfigCorpusOptionString)) != -1)
+	{
+		if (option == 'h')
+		{
+			usage(stdout);
+			return EXIT_SUCCESS;
+		}
+
+		else if (option == 'i')
+		{
+			sampleCount = strtoul(optarg, NULL, 10);
+		}
+
+		else if (!parseIPConfigCorpusOption(&options, option, optarg))
+		{
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!sampleCount || !options.recordCount)
+	{
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	if (!runStringBenchmarks(&options, sampleCount))
+	{
+		return EXIT_FAILURE;
+	}
+
+	for (size_t index = 0; index < options.versionCount; index++)
+	{
+		if (!runCorpusBenchmarks(&options, options.versions[index],
+		                         sampleCount))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "ipconfig.h"
+#include "error.h"
+
+void initializeIPConfigCorpusOptions(struct IPConfigCorpusOptions *options)
+{
+	options->recordCount = 1000;
+	options->dnsCount = 2;
+	options->gatewayCount = 1;
+	options->stringLength = 16;
+
+	options->versions[0] = 3;
+	options->versionCount = 1;
+
+	options->seed = 1;
+}
+
+static bool parseSize(const char *argument, size_t *size)
+{
+	char *terminator = NULL;
+	unsigned long value = strtoul(argument, &terminator, 10);
+
+	if (!*argument || *terminator)
+	{
+		return false;
+	}
+
+	*size = value;
+	return true;
+}
+
+static bool parseVersions(struct IPConfigCorpusOptions *options,
+                          const char *argument)
+{
+	size_t count = 0;
+
+	for (const char *cursor = argument; *cursor; cursor++)
+	{
+		if (*cursor == ',')
+		{
+			continue;
+		}
+
+		if (*cursor < '1' || *cursor > '3' || count == 3)
+		{
+			return false;
+		}
+
+		options->versions[count++] = *cursor - 0x30;
+	}
+
+	options->versionCount = count;
+	return count > 0;
+}
+
+bool parseIPConfigCorpusOption(struct IPConfigCorpusOptions *options,
+                               int option, const char *argument)
+{
+	size_t seed = 0;
+
+	switch (option)
+	{
+		case 'r':
+			return parseSize(argument, &options->recordCount);
+
+		case 'd':
+			return parseSize(argument, &options->dnsCount);
+
+		case 'g':
+			return parseSize(argument, &options->gatewayCount);
+
+		case 'l':
+			return parseSize(argument, &options->stringLength);
+
+		case 'v':
+			return parseVersions(options, argument);
+
+		case 's':
+			if (!parseSize(argument, &seed))
+			{
+				return false;
+			}
+
+			options->seed = seed ? seed : 1;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+void printIPConfigCorpusUsage(FILE *stream)
+{
+	fprintf(stream, "Corpus options:\n");
+	fprintf(stream, "  -r RECORDS    Network records per file\n");
+	fprintf(stream, "  -d DNS        dns entries per record\n");
+	fprintf(stream, "  -g GATEWAYS   gateway entries per record\n");
+	fprintf(stream, "  -l LENGTH     Length of generated strings\n");
+	fprintf(stream, "  -v VERSIONS   Version mix, e.g. 1,2,3\n");
+	fprintf(stream, "  -s SEED       Random seed\n");
+	fprintf(stream, "\n");
+}
+
+static uint32_t generateRandom(struct IPConfigCorpusOptions *options)
+{
+	uint32_t state = options->seed;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return options->seed = state;
+}
+
+uint32_t selectIPConfigCorpusVersion(struct IPConfigCorpusOptions *options)
+{
+	return options->versions[generateRandom(options) %
+	                         options->versionCount];
+}
+
+static void generateString(struct IPConfigCorpusOptions *options,
+                           FILE *stream)
+{
+	static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+	for (size_t index = 0; index < options->stringLength; index++)
+	{
+		fputc(alphabet[generateRandom(options) % (sizeof alphabet - 1)],
+		      stream);
+	}
+}
+
+static void generateAddress(struct IPConfigCorpusOptions *options,
+                            FILE *stream)
+{
+	uint32_t address = generateRandom(options);
+
+	fprintf(stream, "10.%" PRIu32 ".%" PRIu32 ".%" PRIu32,
+	        (address >> 16) & 0xff, (address >> 8) & 0xff,
+	        (address & 0xfe) + 1);
+}
+
+static void generateRecord(struct IPConfigCorpusOptions *options,
+                           uint32_t version, size_t index, FILE *stream)
+{
+	if (version < 3)
+	{
+		fprintf(stream, "id: %zu\n", index);
+	}
+
+	else
+	{
+		fprintf(stream, "id: eth%zu\n", index);
+	}
+
+	fprintf(stream, "ipAssignment: STATIC\n");
+	fprintf(stream, "linkAddress: ");
+	generateAddress(options, stream);
+	fprintf(stream, "/24\n");
+
+	for (size_t gateway = 0; gateway < options->gatewayCount; gateway++)
+	{
+		fprintf(stream, "gateway: ");
+
+		if (version > 1 && gateway % 2)
+		{
+			generateAddress(options, stream);
+			fprintf(stream, "/16 ");
+		}
+
+		generateAddress(options, stream);
+		fputc('\n', stream);
+	}
+
+	for (size_t dns = 0; dns < options->dnsCount; dns++)
+	{
+		fprintf(stream, "dns: ");
+		generateAddress(options, stream);
+		fputc('\n', stream);
+	}
+
+	fprintf(stream, "proxySettings: STATIC\n");
+	fprintf(stream, "proxyHost: ");
+	generateString(options, stream);
+	fprintf(stream, "\nproxyPort: %" PRIu32 "\n",
+	        generateRandom(options) % 65536);
+	fprintf(stream, "exclusionList: ");
+	generateString(options, stream);
+	fputc('\n', stream);
+}
+
+bool generateUnpackedIPConfigCorpus(struct IPConfigCorpusOptions *options,
+                                    uint32_t version, FILE *stream)
+{
+	for (size_t index = 0; index < options->recordCount; index++)
+	{
+		if (index)
+		{
+			fputc('\n', stream);
+		}
+
+		generateRecord(options, version, index, stream);
+	}
+
+	return !ferror(stream);
+}
+
+bool generatePackedIPConfigCorpus(struct IPConfigCorpusOptions *options,
+                                  uint32_t version, FILE *stream)
+{
+	struct IPConfigReader reader = {0};
+	struct IPConfigWriter writer = {0};
+	struct IPConfig config = {0};
+
+	char *text = NULL;
+	size_t size = 0;
+	FILE *textStream = open_memstream(&text, &size);
+	bool generated = false;
+
+	if (!textStream)
+	{
+		printLibraryError("open_memstream");
+		return false;
+	}
+
+	generated = generateUnpackedIPConfigCorpus(options, version,
+	                                           textStream);
+
+	if (fclose(textStream) == EOF || !generated)
+	{
+		free(text);
+		return false;
+	}
+
+	textStream = fmemopen(text, size, "r");
+
+	if (!textStream)
+	{
+		printLibraryError("fmemopen");
+		free(text);
+		return false;
+	}
+
+	generated = initializeUnpackedIPConfigReader(&reader, textStream,
+	                                             version) &&
+	            initializePackedIPConfigWriter(&writer, stream, version) &&
+	            convertIPConfig(&reader, &writer, &config);
+
+	deinitializeIPConfigReader(&reader);
+	deinitializeIPConfig(&config);
+	fclose(textStream);
+	free(text);
+
+	return generated;
+}
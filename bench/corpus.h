@@ -0,0 +1,36 @@
+#ifndef IPCONFIG_CORPUS_H
+#define IPCONFIG_CORPUS_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define IPConfigCorpusOptionString "r:d:g:l:v:s:"
+
+struct IPConfigCorpusOptions
+{
+	size_t recordCount;
+	size_t dnsCount;
+	size_t gatewayCount;
+	size_t stringLength;
+
+	uint32_t versions[3];
+	size_t versionCount;
+
+	uint32_t seed;
+};
+
+void initializeIPConfigCorpusOptions(struct IPConfigCorpusOptions *options);
+bool parseIPConfigCorpusOption(struct IPConfigCorpusOptions *options,
+                               int option, const char *argument);
+void printIPConfigCorpusUsage(FILE *stream);
+
+uint32_t selectIPConfigCorpusVersion(struct IPConfigCorpusOptions *options);
+
+bool generateUnpackedIPConfigCorpus(struct IPConfigCorpusOptions *options,
+                                    uint32_t version, FILE *stream);
+bool generatePackedIPConfigCorpus(struct IPConfigCorpusOptions *options,
+                                  uint32_t version, FILE *stream);
+
+#endif
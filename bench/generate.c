@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "corpus.h"
+#include "ipconfig.h"
+#include "error.h"
+
+static void usage(FILE *stream)
+{
+	fprintf(stream, "usage: generate [-t] [CORPUS OPTIONS] "
+	                "[-n FILES -o DIRECTORY]\n");
+	fprintf(stream, "\n");
+	fprintf(stream, "Options:\n");
+	fprintf(stream, "  -t            Generate unpacked text\n");
+	fprintf(stream, "  -n FILES      Number of files to generate\n");
+	fprintf(stream, "  -o DIRECTORY  Write files into DIRECTORY\n");
+	fprintf(stream, "\n");
+	printIPConfigCorpusUsage(stream);
+}
+
+static bool generateFile(struct IPConfigCorpusOptions *options,
+                         bool unpacked, FILE *stream)
+{
+	uint32_t version = selectIPConfigCorpusVersion(options);
+
+	if (unpacked)
+	{
+		return generateUnpackedIPConfigCorpus(options, version, stream);
+	}
+
+	return generatePackedIPConfigCorpus(options, version, stream);
+}
+
+int main(int argc, char *argv[])
+{
+	struct IPConfigCorpusOptions options;
+	int option = 0;
+
+	bool unpacked = false;
+	unsigned long fileCount = 0;
+	const char *directory = NULL;
+
+	setIPConfigErrorStream(stderr);
+	initializeIPConfigCorpusOptions(&options);
+
+	while ((option = getopt(argc, argv,
+	                        "htn:o:" IPConfigCorpusOptionString)) != -1)
+	{
+		if (option == 'h')
+		{
+			usage(stdout);
+			return EXIT_SUCCESS;
+		}
+
+		else if (option == 't')
+		{
+			unpacked = true;
+		}
+
+		else if (option == 'n')
+		{
+			fileCount = strtoul(optarg, NULL, 10);
+		}
+
+		else if (option == 'o')
+		{
+			directory = optarg;
+		}
+
+		else if (!parseIPConfigCorpusOption(&options, option, optarg))
+		{
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!directory)
+	{
+		return generateFile(&options, unpacked, stdout) ?
+		       EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	for (unsigned long index = 0; index < fileCount; index++)
+	{
+		char path[BUFSIZ];
+		FILE *stream = NULL;
+		bool generated = false;
+
+		snprintf(path, sizeof path, "%s/corpus-%05lu.%s", directory,
+		         index, unpacked ? "conf" : "txt");
+
+		if (!(stream = fopen(path, "w")))
+		{
+			printLibraryError(path);
+			return EXIT_FAILURE;
+		}
+
+		generated = generateFile(&options, unpacked, stream);
+
+		if (fclose(stream) == EOF || !generated)
+		{
+			printError("failed to generate corpus");
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,392 @@
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "address.h"
+
+static const uint8_t IPConfigIPv4MappedPrefix[12] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+};
+
+static int getHexadecimalDigit(char character)
+{
+	if (character >= '0' && character <= '9')
+	{
+		return character - '0';
+	}
+
+	if (character >= 'a' && character <= 'f')
+	{
+		return character - 'a' + 10;
+	}
+
+	if (character >= 'A' && character <= 'F')
+	{
+		return character - 'A' + 10;
+	}
+
+	return -1;
+}
+
+static bool parseOctet(const char *data, size_t length, uint8_t *octet)
+{
+	unsigned value = 0;
+
+	if (!length || length > 3 || (length > 1 && data[0] == '0'))
+	{
+		return false;
+	}
+
+	for (size_t index = 0; index < length; index++)
+	{
+		value = value * 10 + (data[index] - '0');
+	}
+
+	if (value > 255)
+	{
+		return false;
+	}
+
+	*octet = value;
+	return true;
+}
+
+#if defined(__SSE2__)
+
+/*
+ * Classify all sixteen characters of a dotted quad at once: one compare
+ * finds the dots, two compares find the digits, and the movemasks tell
+ * whether every character is one or the other and where the fields split.
+ */
+
+static bool parseIPv4(const char *data, size_t length, uint8_t *bytes)
+{
+	char padded[16] = {0};
+	unsigned valid = 0;
+	unsigned dots = 0;
+	unsigned digits = 0;
+	size_t start = 0;
+
+	__m128i input;
+
+	if (length < 7 || length > 15)
+	{
+		return false;
+	}
+
+	valid = (1u << length) - 1;
+	memcpy(padded, data, length);
+	input = _mm_loadu_si128((const __m128i *) padded);
+
+	dots = _mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('.')));
+	digits = _mm_movemask_epi8(
+		_mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('0' - 1)),
+		              _mm_cmplt_epi8(input, _mm_set1_epi8('9' + 1))));
+
+	dots &= valid;
+	digits &= valid;
+
+	if ((dots | digits) != valid || __builtin_popcount(dots) != 3)
+	{
+		return false;
+	}
+
+	for (size_t field = 0; field < 4; field++)
+	{
+		size_t end = field < 3 ? (size_t) __builtin_ctz(dots) : length;
+
+		if (!parseOctet(data + start, end - start, &bytes[field]))
+		{
+			return false;
+		}
+
+		dots &= dots - 1;
+		start = end + 1;
+	}
+
+	return true;
+}
+
+#else
+
+static bool parseIPv4(const char *data, size_t length, uint8_t *bytes)
+{
+	size_t start = 0;
+	size_t field = 0;
+
+	for (size_t index = 0; index <= length; index++)
+	{
+		if (index == length || data[index] == '.')
+		{
+			if (field == 4 ||
+			    !parseOctet(data + start, index - start, &bytes[field]))
+			{
+				return false;
+			}
+
+			field++;
+			start = index + 1;
+		}
+
+		else if (data[index] < '0' || data[index] > '9')
+		{
+			return false;
+		}
+	}
+
+	return field == 4;
+}
+
+#endif
+
+static bool parseIPv6(const char *data, size_t length, uint8_t *bytes)
+{
+	uint8_t groups[16] = {0};
+	size_t count = 0;
+	size_t compression = 16;
+	size_t index = 0;
+
+	if (length >= 2 && data[0] == ':')
+	{
+		if (data[1] != ':')
+		{
+			return false;
+		}
+
+		compression = 0;
+		index = 2;
+	}
+
+	while (index < length)
+	{
+		size_t start = index;
+		unsigned value = 0;
+
+		while (index < length && index - start < 5)
+		{
+			int digit = getHexadecimalDigit(data[index]);
+
+			if (digit < 0)
+			{
+				break;
+			}
+
+			value = value << 4 | digit;
+			index++;
+		}
+
+		if (index < length && data[index] == '.')
+		{
+			if (count > 12 ||
+			    !parseIPv4(data + start, length - start, groups + count))
+			{
+				return false;
+			}
+
+			count += 4;
+			index = length;
+			break;
+		}
+
+		if (index == start || index - start > 4 || count > 14)
+		{
+			return false;
+		}
+
+		groups[count++] = value >> 8;
+		groups[count++] = value & 0xff;
+
+		if (index == length)
+		{
+			break;
+		}
+
+		if (data[index] != ':' || ++index == length)
+		{
+			return false;
+		}
+
+		if (data[index] == ':')
+		{
+			if (compression != 16)
+			{
+				return false;
+			}
+
+			compression = count;
+
+			if (++index == length)
+			{
+				break;
+			}
+		}
+	}
+
+	if (compression == 16)
+	{
+		if (count != 16)
+		{
+			return false;
+		}
+
+		memcpy(bytes, groups, 16);
+		return true;
+	}
+
+	if (count == 16)
+	{
+		return false;
+	}
+
+	memset(bytes, 0, 16);
+	memcpy(bytes, groups, compression);
+	memcpy(bytes + 16 - (count - compression), groups + compression,
+	       count - compression);
+
+	return true;
+}
+
+bool parseIPConfigAddress(const char *data, size_t length,
+                          struct IPConfigAddress *address)
+{
+	memset(address, 0, sizeof *address);
+
+	if (memchr(data, ':', length))
+	{
+		if (!parseIPv6(data, length, address->bytes))
+		{
+			return false;
+		}
+
+		address->family = IPv6IPConfigAddressFamily;
+		address->prefix = 128;
+
+		return true;
+	}
+
+	if (!parseIPv4(data, length, address->bytes))
+	{
+		return false;
+	}
+
+	address->family = IPv4IPConfigAddressFamily;
+	address->prefix = 32;
+
+	return true;
+}
+
+bool isIPConfigHostName(const char *data, size_t length)
+{
+	if (!length || length > 253 || data[0] == '.' || data[0] == '-')
+	{
+		return false;
+	}
+
+	for (size_t index = 0; index < length; index++)
+	{
+		char character = data[index];
+
+		if (!(character >= 'a' && character <= 'z') &&
+		    !(character >= 'A' && character <= 'Z') &&
+		    !(character >= '0' && character <= '9') &&
+		    character != '-' && character != '.' && character != '_')
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static size_t formatIPv4(const uint8_t *bytes, char *buffer)
+{
+	return sprintf(buffer, "%u.%u.%u.%u",
+	               bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+size_t formatIPConfigAddress(const struct IPConfigAddress *address,
+                             char *buffer)
+{
+	const uint8_t *bytes = address->bytes;
+	size_t zeroStart = 8;
+	size_t zeroLength = 0;
+	char *cursor = buffer;
+
+	if (address->family == IPv4IPConfigAddressFamily)
+	{
+		return formatIPv4(bytes, buffer);
+	}
+
+	if (address->family != IPv6IPConfigAddressFamily)
+	{
+		*buffer = 0;
+		return 0;
+	}
+
+	if (!memcmp(bytes, IPConfigIPv4MappedPrefix,
+	            sizeof IPConfigIPv4MappedPrefix))
+	{
+		cursor += sprintf(cursor, "::ffff:");
+		return cursor - buffer + formatIPv4(bytes + 12, cursor);
+	}
+
+	for (size_t group = 0; group < 8; )
+	{
+		size_t length = 0;
+
+		while (group + length < 8 &&
+		       !bytes[(group + length) * 2] &&
+		       !bytes[(group + length) * 2 + 1])
+		{
+			length++;
+		}
+
+		if (length > zeroLength && length > 1)
+		{
+			zeroStart = group;
+			zeroLength = length;
+		}
+
+		group += length ? length : 1;
+	}
+
+	for (size_t group = 0; group < 8; group++)
+	{
+		if (group == zeroStart)
+		{
+			cursor += sprintf(cursor, "::");
+			group += zeroLength - 1;
+			continue;
+		}
+
+		if (group && group != zeroStart + zeroLength)
+		{
+			*cursor++ = ':';
+		}
+
+		cursor += sprintf(cursor, "%x",
+		                  bytes[group * 2] << 8 | bytes[group * 2 + 1]);
+	}
+
+	return cursor - buffer;
+}
+
+int compareIPConfigAddresses(const struct IPConfigAddress *left,
+                             const struct IPConfigAddress *right)
+{
+	if (left->family != right->family)
+	{
+		return left->family < right->family ? -1 : 1;
+	}
+
+	if (left->prefix != right->prefix)
+	{
+		return left->prefix < right->prefix ? -1 : 1;
+	}
+
+	return memcmp(left->bytes, right->bytes, sizeof left->bytes);
+}
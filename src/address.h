@@ -0,0 +1,34 @@
+#ifndef IPCONFIG_ADDRESS_H
+#define IPCONFIG_ADDRESS_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+#define IPConfigAddressStringLength 46
+
+enum IPConfigAddressFamily
+{
+	InvalidIPConfigAddressFamily = 0,
+	IPv4IPConfigAddressFamily = 4,
+	IPv6IPConfigAddressFamily = 6
+};
+
+struct IPConfigAddress
+{
+	uint8_t family;
+	uint8_t prefix;
+	uint8_t bytes[16];
+};
+
+bool parseIPConfigAddress(const char *data, size_t length,
+                          struct IPConfigAddress *address);
+bool isIPConfigHostName(const char *data, size_t length);
+
+size_t formatIPConfigAddress(const struct IPConfigAddress *address,
+                             char *buffer);
+
+int compareIPConfigAddresses(const struct IPConfigAddress *left,
+                             const struct IPConfigAddress *right);
+
+#endif
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "stats.h"
+#include "trace.h"
+
+static const size_t IPConfigArenaBlockSize = 16384;
+static const size_t IPConfigArenaAlignment = 2 * sizeof(void *);
+
+static size_t alignIPConfigArenaSize(size_t size)
+{
+	return (size + IPConfigArenaAlignment - 1) &
+	       ~(IPConfigArenaAlignment - 1);
+}
+
+static struct IPConfigArenaBlock *createBlock(size_t size)
+{
+	struct IPConfigArenaBlock *block = NULL;
+	size_t headerSize = alignIPConfigArenaSize(sizeof *block);
+
+	if (size < IPConfigArenaBlockSize)
+	{
+		size = IPConfigArenaBlockSize;
+	}
+
+	block = malloc(headerSize + size);
+
+	if (!block)
+	{
+		return NULL;
+	}
+
+	countIPConfigAllocation(headerSize + size);
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	block->data = (unsigned char *) block + headerSize;
+
+	return block;
+}
+
+void *allocateIPConfigArena(struct IPConfigArena *arena, size_t size)
+{
+	struct IPConfigArenaBlock *block = arena->current;
+	void *memory = NULL;
+
+	size = alignIPConfigArenaSize(size ? size : 1);
+
+	if (!block || block->size - block->used < size)
+	{
+		struct IPConfigArenaBlock *next = block ? block->next
+		                                        : arena->blocks;
+
+		if (next && next->size >= size)
+		{
+			next->used = 0;
+		}
+
+		else
+		{
+			struct IPConfigArenaBlock *created = createBlock(size);
+
+			if (!created)
+			{
+				return NULL;
+			}
+
+			created->next = next;
+
+			if (block)
+			{
+				block->next = created;
+			}
+
+			else
+			{
+				arena->blocks = created;
+			}
+
+			next = created;
+		}
+
+		arena->current = block = next;
+	}
+
+	memory = block->data + block->used;
+	block->used += size;
+	countIPConfigArenaAllocation(size);
+
+	return memset(memory, 0, size);
+}
+
+char *duplicateIPConfigArenaString(struct IPConfigArena *arena,
+                                   const char *string, size_t length)
+{
+	char *duplicate = allocateIPConfigArena(arena, length + 1);
+
+	if (!duplicate)
+	{
+		return NULL;
+	}
+
+	memcpy(duplicate, string, length);
+	traceIPConfig2(string__allocate, duplicate, length);
+
+	return duplicate;
+}
+
+void resetIPConfigArena(struct IPConfigArena *arena)
+{
+	arena->current = arena->blocks;
+
+	if (arena->current)
+	{
+		arena->current->used = 0;
+	}
+}
+
+void deinitializeIPConfigArena(struct IPConfigArena *arena)
+{
+	struct IPConfigArenaBlock *block = arena->blocks;
+
+	while (block)
+	{
+		struct IPConfigArenaBlock *next = block->next;
+		free(block);
+		block = next;
+	}
+
+	arena->blocks = NULL;
+	arena->current = NULL;
+}
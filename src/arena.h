@@ -0,0 +1,27 @@
+#ifndef IPCONFIG_ARENA_H
+#define IPCONFIG_ARENA_H
+
+#include <stddef.h>
+
+struct IPConfigArenaBlock
+{
+	struct IPConfigArenaBlock *next;
+	size_t size;
+	size_t used;
+	unsigned char *data;
+};
+
+struct IPConfigArena
+{
+	struct IPConfigArenaBlock *blocks;
+	struct IPConfigArenaBlock *current;
+};
+
+void *allocateIPConfigArena(struct IPConfigArena *arena, size_t size);
+char *duplicateIPConfigArenaString(struct IPConfigArena *arena,
+                                   const char *string, size_t length);
+
+void resetIPConfigArena(struct IPConfigArena *arena);
+void deinitializeIPConfigArena(struct IPConfigArena *arena);
+
+#endif
@@ -0,0 +1,558 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "data.h"
+#include "ipconfig.h"
+#include "error.h"
+
+static const size_t IPConfigBatchMinimumPathCapacity = 64;
+
+struct IPConfigBatchWorker
+{
+	struct IPConfigBatch *batch;
+	struct IPConfigBatchWorker *workers;
+	size_t identifier;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	size_t top;
+	size_t bottom;
+
+	size_t convertedCount;
+	size_t failedCount;
+	size_t recordCount;
+	size_t droppedCount;
+	struct IPConfigStats stats;
+};
+
+void initializeIPConfigBatch(struct IPConfigBatch *batch,
+                             const char *outputDirectory,
+                             bool pack, uint32_t version)
+{
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	memset(batch, 0, sizeof *batch);
+	batch->outputDirectory = outputDirectory;
+	batch->pack = pack;
+	batch->version = version;
+	batch->threadCount = processorCount > 0 ? processorCount : 1;
+}
+
+static bool appendPath(struct IPConfigBatch *batch, char *path)
+{
+	if (batch->pathCount == batch->pathCapacity)
+	{
+		size_t capacity = batch->pathCapacity * 2;
+		char **paths = NULL;
+
+		if (capacity < IPConfigBatchMinimumPathCapacity)
+		{
+			capacity = IPConfigBatchMinimumPathCapacity;
+		}
+
+		paths = realloc(batch->paths, capacity * sizeof *paths);
+
+		if (!paths)
+		{
+			printLibraryError("realloc");
+			return false;
+		}
+
+		batch->paths = paths;
+		batch->pathCapacity = capacity;
+	}
+
+	batch->paths[batch->pathCount++] = path;
+	return true;
+}
+
+static bool addFile(struct IPConfigBatch *batch, const char *directory,
+                    const char *name)
+{
+	size_t length = strlen(name) + 1;
+	char *path = NULL;
+
+	if (directory)
+	{
+		length += strlen(directory) + 1;
+	}
+
+	path = malloc(length);
+
+	if (!path)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	if (directory)
+	{
+		snprintf(path, length, "%s/%s", directory, name);
+	}
+
+	else
+	{
+		memcpy(path, name, length);
+	}
+
+	if (!appendPath(batch, path))
+	{
+		free(path);
+		return false;
+	}
+
+	return true;
+}
+
+static bool addDirectory(struct IPConfigBatch *batch, const char *directory)
+{
+	DIR *stream = opendir(directory);
+	struct dirent *entry = NULL;
+
+	if (!stream)
+	{
+		printLibraryError(directory);
+		return false;
+	}
+
+	while ((entry = readdir(stream)))
+	{
+		if (entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		if (entry->d_type == DT_UNKNOWN)
+		{
+			struct stat status;
+
+			if (fstatat(dirfd(stream), entry->d_name,
+			            &status, 0) == -1 ||
+			    !S_ISREG(status.st_mode))
+			{
+				continue;
+			}
+		}
+
+		else if (entry->d_type != DT_REG)
+		{
+			continue;
+		}
+
+		if (!addFile(batch, directory, entry->d_name))
+		{
+			closedir(stream);
+			return false;
+		}
+	}
+
+	closedir(stream);
+	return true;
+}
+
+bool addIPConfigBatchPath(struct IPConfigBatch *batch, const char *path)
+{
+	struct stat status;
+
+	if (stat(path, &status) == -1)
+	{
+		printLibraryError(path);
+		return false;
+	}
+
+	if (S_ISDIR(status.st_mode))
+	{
+		return addDirectory(batch, path);
+	}
+
+	return addFile(batch, NULL, path);
+}
+
+bool addIPConfigBatchManifest(struct IPConfigBatch *batch,
+                              const char *manifest)
+{
+	FILE *stream = fopen(manifest, "r");
+	char line[BUFSIZ];
+
+	if (!stream)
+	{
+		printLibraryError(manifest);
+		return false;
+	}
+
+	while (fgets(line, sizeof line, stream))
+	{
+		line[strcspn(line, "\n")] = 0;
+
+		if (!*line)
+		{
+			continue;
+		}
+
+		if (!addIPConfigBatchPath(batch, line))
+		{
+			fclose(stream);
+			return false;
+		}
+	}
+
+	fclose(stream);
+	return true;
+}
+
+static const char *getOutputName(const char *path)
+{
+	const char *name = strrchr(path, '/');
+	return name ? name + 1 : path;
+}
+
+static int compareOutputNames(const void *left, const void *right)
+{
+	return strcmp(getOutputName(*(char * const *) left),
+	              getOutputName(*(char * const *) right));
+}
+
+/*
+ * Outputs are named after their input alone, so two inputs sharing a name
+ * would write the same file.  They are refused before anything is written.
+ */
+
+static bool checkOutputNames(struct IPConfigBatch *batch)
+{
+	char **paths = NULL;
+	bool unique = true;
+
+	if (batch->pathCount < 2)
+	{
+		return true;
+	}
+
+	if (!(paths = malloc(batch->pathCount * sizeof *paths)))
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	memcpy(paths, batch->paths, batch->pathCount * sizeof *paths);
+	qsort(paths, batch->pathCount, sizeof *paths, compareOutputNames);
+
+	for (size_t index = 1; index < batch->pathCount; index++)
+	{
+		if (!compareOutputNames(&paths[index - 1], &paths[index]))
+		{
+			reportIPConfigError(paths[index], 0, "output %s/%s is also "
+			                    "written for %s", batch->outputDirectory,
+			                    getOutputName(paths[index]),
+			                    paths[index - 1]);
+			unique = false;
+		}
+	}
+
+	free(paths);
+	return unique;
+}
+
+static bool isSameFile(FILE *input, const char *outputPath)
+{
+	struct stat inputStatus;
+	struct stat outputStatus;
+
+	return fstat(fileno(input), &inputStatus) == 0 &&
+	       stat(outputPath, &outputStatus) == 0 &&
+	       inputStatus.st_dev == outputStatus.st_dev &&
+	       inputStatus.st_ino == outputStatus.st_ino;
+}
+
+/*
+ * Each output is built in memory and then renamed into place, so a failed
+ * conversion leaves whatever was there before untouched.
+ */
+
+static bool convertFile(struct IPConfigBatch *batch, const char *path,
+                        struct IPConfig *config, size_t *recordCount,
+                        size_t *droppedCount)
+{
+	struct IPConfigReader reader = {0};
+	struct IPConfigWriter writer = {0};
+
+	const char *name = getOutputName(path);
+	size_t length = strlen(batch->outputDirectory) + strlen(name) + 2;
+	char *outputPath = NULL;
+
+	FILE *input = NULL;
+	FILE *output = NULL;
+	char *contents = NULL;
+	size_t contentsSize = 0;
+	bool converted = false;
+	bool replaced = false;
+	enum IPConfigStatsPhase phase = NoIPConfigStatsPhase;
+
+	outputPath = malloc(length);
+
+	if (!outputPath)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	snprintf(outputPath, length, "%s/%s", batch->outputDirectory, name);
+
+	if (!(input = fopen(path, "r")))
+	{
+		printLibraryError(path);
+		free(outputPath);
+		return false;
+	}
+
+	if (isSameFile(input, outputPath))
+	{
+		reportIPConfigError(outputPath, 0, "output is the input file");
+		free(outputPath);
+		fclose(input);
+		return false;
+	}
+
+	if (!(output = open_memstream(&contents, &contentsSize)))
+	{
+		printLibraryError("open_memstream");
+		free(outputPath);
+		fclose(input);
+		return false;
+	}
+
+	if (batch->pack && batch->json)
+	{
+		converted = initializeJSONIPConfigReader(&reader, input,
+		                                         batch->version) &&
+		            initializePackedIPConfigWriter(&writer, output,
+		                                           batch->version);
+	}
+
+	else if (batch->pack)
+	{
+		converted = initializeUnpackedIPConfigReader(&reader, input,
+		                                             batch->version) &&
+		            initializePackedIPConfigWriter(&writer, output,
+		                                           batch->version);
+	}
+
+	else if (batch->transcode)
+	{
+		converted = initializeMappedIPConfigReader(&reader, input) &&
+		            initializePackedIPConfigWriter(&writer, output,
+		                                           batch->version);
+	}
+
+	else if (batch->json)
+	{
+		converted = initializeMappedIPConfigReader(&reader, input);
+		initializeJSONIPConfigWriter(&writer, output);
+	}
+
+	else
+	{
+		converted = initializeMappedIPConfigReader(&reader, input);
+		initializeUnpackedIPConfigWriter(&writer, output);
+	}
+
+	reader.addressMode = batch->addressMode;
+	converted = converted && convertIPConfig(&reader, &writer, config);
+	deinitializeIPConfigReader(&reader);
+	fclose(input);
+
+	if (fclose(output) == EOF)
+	{
+		printLibraryError("open_memstream");
+		converted = false;
+	}
+
+	phase = enterIPConfigStatsPhase(WriteIPConfigStatsPhase);
+
+	converted = converted && replaceFileIfChanged(outputPath, contents,
+	                                              contentsSize, &replaced);
+
+	enterIPConfigStatsPhase(phase);
+
+	free(contents);
+	free(outputPath);
+	*recordCount = writer.recordCount;
+	*droppedCount = writer.droppedCount;
+
+	return converted;
+}
+
+static bool takeTask(struct IPConfigBatchWorker *worker, size_t *index)
+{
+	size_t workerCount = worker->batch->threadCount;
+	bool taken = false;
+
+	pthread_mutex_lock(&worker->lock);
+
+	if (worker->top < worker->bottom)
+	{
+		*index = --worker->bottom;
+		taken = true;
+	}
+
+	pthread_mutex_unlock(&worker->lock);
+
+	for (size_t step = 1; !taken && step < workerCount; step++)
+	{
+		size_t identifier = (worker->identifier + step) % workerCount;
+		struct IPConfigBatchWorker *victim = &worker->workers[identifier];
+
+		pthread_mutex_lock(&victim->lock);
+
+		if (victim->top < victim->bottom)
+		{
+			*index = victim->top++;
+			taken = true;
+		}
+
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	return taken;
+}
+
+static void *runWorker(void *context)
+{
+	struct IPConfigBatchWorker *worker = context;
+	struct IPConfigBatch *batch = worker->batch;
+	struct IPConfig config = {0};
+	size_t index = 0;
+
+	if (batch->collectStats)
+	{
+		startIPConfigStats(&worker->stats);
+	}
+
+	while (takeTask(worker, &index))
+	{
+		const char *path = batch->paths[index];
+		size_t recordCount = 0;
+		size_t droppedCount = 0;
+
+		worker->stats.fileCount++;
+
+		if (convertFile(batch, path, &config, &recordCount, &droppedCount))
+		{
+			worker->convertedCount++;
+			worker->recordCount += recordCount;
+			worker->droppedCount += droppedCount;
+		}
+
+		else
+		{
+			reportIPConfigError(path, 0, "conversion failed");
+			worker->failedCount++;
+		}
+	}
+
+	deinitializeIPConfig(&config);
+	stopIPConfigStats();
+
+	return NULL;
+}
+
+bool runIPConfigBatch(struct IPConfigBatch *batch)
+{
+	struct IPConfigBatchWorker *workers = NULL;
+	size_t workerCount = batch->threadCount;
+	size_t startedCount = 0;
+
+	if (!checkOutputNames(batch))
+	{
+		batch->failedCount = batch->pathCount;
+		return false;
+	}
+
+	if (workerCount > batch->pathCount)
+	{
+		workerCount = batch->pathCount ? batch->pathCount : 1;
+	}
+
+	batch->threadCount = workerCount;
+	workers = calloc(workerCount, sizeof *workers);
+
+	if (!workers)
+	{
+		printLibraryError("calloc");
+		return false;
+	}
+
+	for (size_t identifier = 0; identifier < workerCount; identifier++)
+	{
+		struct IPConfigBatchWorker *worker = &workers[identifier];
+
+		worker->batch = batch;
+		worker->workers = workers;
+		worker->identifier = identifier;
+		worker->top = batch->pathCount * identifier / workerCount;
+		worker->bottom = batch->pathCount * (identifier + 1) / workerCount;
+
+		pthread_mutex_init(&worker->lock, NULL);
+	}
+
+	for (; startedCount < workerCount; startedCount++)
+	{
+		struct IPConfigBatchWorker *worker = &workers[startedCount];
+
+		if (pthread_create(&worker->thread, NULL, runWorker, worker))
+		{
+			printError("failed to start worker");
+			break;
+		}
+	}
+
+	if (!startedCount)
+	{
+		runWorker(&workers[0]);
+	}
+
+	for (size_t identifier = 0; identifier < startedCount; identifier++)
+	{
+		pthread_join(workers[identifier].thread, NULL);
+	}
+
+	for (size_t identifier = 0; identifier < workerCount; identifier++)
+	{
+		struct IPConfigBatchWorker *worker = &workers[identifier];
+
+		batch->convertedCount += worker->convertedCount;
+		batch->failedCount += worker->failedCount;
+		batch->recordCount += worker->recordCount;
+		batch->droppedCount += worker->droppedCount;
+		addIPConfigStats(&batch->stats, &worker->stats);
+
+		pthread_mutex_destroy(&worker->lock);
+	}
+
+	free(workers);
+	return batch->failedCount == 0;
+}
+
+void deinitializeIPConfigBatch(struct IPConfigBatch *batch)
+{
+	for (size_t index = 0; index < batch->pathCount; index++)
+	{
+		free(batch->paths[index]);
+	}
+
+	free(batch->paths);
+
+	batch->paths = NULL;
+	batch->pathCount = 0;
+	batch->pathCapacity = 0;
+}
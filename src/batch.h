@@ -0,0 +1,42 @@
+#ifndef IPCONFIG_BATCH_H
+#define IPCONFIG_BATCH_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "ipconfig.h"
+#include "stats.h"
+
+struct IPConfigBatch
+{
+	char **paths;
+	size_t pathCount;
+	size_t pathCapacity;
+
+	const char *outputDirectory;
+	bool pack;
+	bool transcode;
+	bool json;
+	uint32_t version;
+	enum IPConfigAddressMode addressMode;
+	size_t threadCount;
+	bool collectStats;
+
+	size_t convertedCount;
+	size_t failedCount;
+	size_t recordCount;
+	size_t droppedCount;
+	struct IPConfigStats stats;
+};
+
+void initializeIPConfigBatch(struct IPConfigBatch *batch,
+                             const char *outputDirectory,
+                             bool pack, uint32_t version);
+bool addIPConfigBatchPath(struct IPConfigBatch *batch, const char *path);
+bool addIPConfigBatchManifest(struct IPConfigBatch *batch,
+                              const char *manifest);
+bool runIPConfigBatch(struct IPConfigBatch *batch);
+void deinitializeIPConfigBatch(struct IPConfigBatch *batch);
+
+#endif
@@ -6,7 +6,17 @@
 #include <stdio.h>
 #include <ctype.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "data.h"
+#include "error.h"
+#include "stats.h"
+#include "trace.h"
 
 uint16_t convertBigEndianUInt16(uint16_t value)
 {
@@ -40,17 +50,122 @@ uint32_t convertBigEndianUInt32(uint32_t value)
 	return aux.value;
 }
 
-bool readPackedLink(FILE *stream, struct IPConfigLink *link)
+bool isPackedInputFinished(struct IPConfigInput *input)
+{
+	int character = 0;
+
+	if (!input->stream)
+	{
+		return input->offset >= input->size;
+	}
+
+	character = fgetc(input->stream);
+
+	if (character == EOF)
+	{
+		return true;
+	}
+
+	ungetc(character, input->stream);
+	return false;
+}
+
+static bool readPackedBytes(struct IPConfigInput *input,
+                            void *buffer, size_t size)
+{
+	if (input->stream)
+	{
+		if (fread(buffer, size, 1, input->stream) != 1)
+		{
+			return false;
+		}
+
+		input->offset += size;
+		return true;
+	}
+
+	if (input->size - input->offset < size)
+	{
+		return false;
+	}
+
+	memcpy(buffer, input->data + input->offset, size);
+	input->offset += size;
+
+	return true;
+}
+
+static bool skipPackedBytes(struct IPConfigInput *input, size_t size)
+{
+	if (input->stream)
+	{
+		char buffer[BUFSIZ];
+
+		if (fseek(input->stream, size, SEEK_CUR) != -1)
+		{
+			input->offset += size;
+			return true;
+		}
+
+		while (size)
+		{
+			size_t count = size < sizeof buffer ? size : sizeof buffer;
+
+			if (fread(buffer, count, 1, input->stream) != 1)
+			{
+				return false;
+			}
+
+			input->offset += count;
+			size -= count;
+		}
+
+		return true;
+	}
+
+	if (input->size - input->offset < size)
+	{
+		return false;
+	}
+
+	input->offset += size;
+	return true;
+}
+
+bool readPackedValue(struct IPConfigInput *input,
+                     enum IPConfigAttributeType type,
+                     union IPConfigValue *value)
+{
+	switch (type)
+	{
+		case IntegerIPConfigAttributeType:
+			return readPackedUInt32(input, &value->integer);
+
+		case StringIPConfigAttributeType:
+			return readPackedString(input, &value->string);
+
+		case LinkIPConfigAttributeType:
+			return readPackedLink(input, &value->link);
+
+		case RouteIPConfigAttributeType:
+			return readPackedRoute(input, &value->route);
+
+		default:
+			return false;
+	}
+}
+
+bool readPackedLink(struct IPConfigInput *input, struct IPConfigLink *link)
 {
-	char **address = &link->address;
+	struct IPConfigString *address = &link->address;
 	uint32_t *prefix = &link->prefix;
 
-	if (!readPackedString(stream, address))
+	if (!readPackedString(input, address))
 	{
 		return false;
 	}
 
-	if (!readPackedUInt32(stream, prefix))
+	if (!readPackedUInt32(input, prefix))
 	{
 		return false;
 	}
@@ -58,41 +173,41 @@ bool readPackedLink(FILE *stream, struct IPConfigLink *link)
 	return true;
 }
 
-bool readPackedRoute(FILE *stream, struct IPConfigRoute *route)
+bool readPackedRoute(struct IPConfigInput *input, struct IPConfigRoute *route)
 {
-	char **destinationAddress = &route->destination.address;
+	struct IPConfigString *destinationAddress = &route->destination.address;
 	uint32_t *destinationPrefix = &route->destination.prefix;
-	char **nextHop = &route->nextHop;
+	struct IPConfigString *nextHop = &route->nextHop;
 
 	uint32_t haveDestination = 0;
 	uint32_t haveNextHop = 0;
 
-	if (!readPackedUInt32(stream, &haveDestination))
+	if (!readPackedUInt32(input, &haveDestination))
 	{
 		return false;
 	}
 
 	if (haveDestination)
 	{
-		if (!readPackedString(stream, destinationAddress))
+		if (!readPackedString(input, destinationAddress))
 		{
 			return false;
 		}
 
-		if (!readPackedUInt32(stream, destinationPrefix))
+		if (!readPackedUInt32(input, destinationPrefix))
 		{
 			return false;
 		}
 	}
 
-	if (!readPackedUInt32(stream, &haveNextHop))
+	if (!readPackedUInt32(input, &haveNextHop))
 	{
 		return false;
 	}
 
 	if (haveNextHop)
 	{
-		if (!readPackedString(stream, nextHop))
+		if (!readPackedString(input, nextHop))
 		{
 			return false;
 		}
@@ -101,283 +216,1389 @@ bool readPackedRoute(FILE *stream, struct IPConfigRoute *route)
 	return true;
 }
 
-bool readPackedString(FILE *stream, char **string)
+bool readPackedStringLength(struct IPConfigInput *input, uint16_t *length)
 {
-	uint16_t length = 0;
-
-	if (!readPackedUInt16(stream, &length))
+	if (!readPackedUInt16(input, length))
 	{
 		return false;
 	}
 
-	while (length == 0)
+	while (*length == 0)
 	{
-		if (fseek(stream, sizeof(uint16_t), SEEK_CUR) == -1)
+		if (!skipPackedBytes(input, sizeof(uint16_t)))
 		{
 			return false;
 		}
 
-		if (!readPackedUInt16(stream, &length))
+		if (!readPackedUInt16(input, length))
 		{
 			return false;
 		}
 	}
 
-	*string = calloc(1, length + 1);
+	return true;
+}
+
+bool skipPackedString(struct IPConfigInput *input)
+{
+	uint16_t length = 0;
 
-	if (!*string)
+	if (!readPackedStringLength(input, &length))
 	{
 		return false;
 	}
 
-	if (fread(*string, length, 1, stream) != 1)
+	if (!input->stream && length > input->size - input->offset)
 	{
-		if (!feof(stream))
-		{
-			free(*string);
-			return false;
-		}
+		return false;
 	}
 
-	return true;
+	return skipPackedBytes(input, length);
 }
 
-bool readPackedUInt16(FILE *stream, uint16_t *value)
+/*
+ * Compares a string against an expected value as it is read, a chunk at a
+ * time when reading from a stream, so that neither side is ever copied.
+ */
+
+bool matchPackedString(struct IPConfigInput *input,
+                       const char *expected, size_t expectedLength,
+                       bool *matched)
 {
-	uint16_t buffer = 0; 
+	uint16_t length = 0;
+	size_t compared = 0;
 
-	if (fread(&buffer, sizeof buffer, 1, stream) != 1)
+	if (!readPackedStringLength(input, &length))
 	{
 		return false;
 	}
 
-	*value = convertBigEndianUInt16(buffer);
-	return true;
-}
-
-bool readPackedUInt32(FILE *stream, uint32_t *value)
-{
-	uint32_t buffer = 0; 
-
-	if (fread(&buffer, sizeof buffer, 1, stream) != 1)
+	if (!input->stream && length > input->size - input->offset)
 	{
 		return false;
 	}
 
-	*value = convertBigEndianUInt32(buffer);
-	return true;
-}
+	*matched = length == expectedLength;
 
-bool writePackedRoute(struct IPConfigRoute *route, FILE *stream)
-{
-	struct IPConfigLink *destination = &route->destination;
+	if (!*matched || !input->stream)
+	{
+		*matched = *matched && !memcmp(input->data + input->offset,
+		                               expected, length);
+		return skipPackedBytes(input, length);
+	}
 
-	if (destination->address && destination->prefix)
+	while (compared < length)
 	{
-		if (!writePackedUInt32(1, stream))
-		{
-			return false;
-		}
+		char buffer[256];
+		size_t count = length - compared;
 
-		if (!writePackedString(destination->address, stream))
+		if (count > sizeof buffer)
 		{
-			return false;
+			count = sizeof buffer;
 		}
 
-		if (!writePackedUInt32(destination->prefix, stream))
+		if (!readPackedBytes(input, buffer, count))
 		{
 			return false;
 		}
+
+		*matched = *matched && !memcmp(buffer, expected + compared, count);
+		compared += count;
 	}
 
-	else
+	return true;
+}
+
+bool skipPackedValue(struct IPConfigInput *input,
+                     enum IPConfigAttributeType type)
+{
+	uint32_t present = 0;
+
+	switch (type)
 	{
-		if (!writePackedUInt32(0, stream))
-		{
+		case IntegerIPConfigAttributeType:
+			return skipPackedBytes(input, sizeof(uint32_t));
+
+		case StringIPConfigAttributeType:
+			return skipPackedString(input);
+
+		case LinkIPConfigAttributeType:
+			return skipPackedString(input) &&
+			       skipPackedBytes(input, sizeof(uint32_t));
+
+		case RouteIPConfigAttributeType:
+			if (!readPackedUInt32(input, &present))
+			{
+				return false;
+			}
+
+			if (present && !skipPackedValue(input,
+			                                LinkIPConfigAttributeType))
+			{
+				return false;
+			}
+
+			if (!readPackedUInt32(input, &present))
+			{
+				return false;
+			}
+
+			return !present || skipPackedString(input);
+
+		default:
 			return false;
-		}
+	}
+}
+
+bool readPackedString(struct IPConfigInput *input,
+                      struct IPConfigString *string)
+{
+	return readPackedStringInto(input, NULL, 0, string);
+}
+
+/*
+ * Strings shorter than the caller's buffer are read into it instead of the
+ * arena when reading from a stream, so that the caller may discard them or
+ * substitute an interned copy without leaving a dead allocation behind.
+ */
+
+bool readPackedStringInto(struct IPConfigInput *input,
+                          char *buffer, size_t capacity,
+                          struct IPConfigString *string)
+{
+	uint16_t length = 0;
+	char *data = buffer;
+
+	if (!readPackedStringLength(input, &length))
+	{
+		return false;
 	}
 
-	if (route->nextHop)
+	if (!input->stream)
 	{
-		if (!writePackedUInt32(1, stream))
+		if (length > input->size - input->offset)
 		{
 			return false;
 		}
 
-		if (!writePackedString(route->nextHop, stream))
-		{
-			return false;
-		}
+		string->data = (const char *) input->data + input->offset;
+		string->length = length;
+		input->offset += length;
+
+		return true;
 	}
 
-	else
+	if (length >= capacity)
 	{
-		if (!writePackedUInt32(0, stream))
-		{
-			return false;
-		}
+		data = allocateIPConfigArena(input->arena, length + 1);
+		traceIPConfig2(string__allocate, data, length);
 	}
 
-	return true;
-}
+	else
+	{
+		memset(data, 0, length + 1);
+	}
 
-bool writePackedLink(struct IPConfigLink *link, FILE *stream)
-{
-	if (!writePackedString(link->address, stream))
+	if (!data)
 	{
 		return false;
 	}
 
-	if (!writePackedUInt32(link->prefix, stream))
+	if (fread(data, length, 1, input->stream) != 1)
 	{
 		return false;
 	}
 
+	input->offset += length;
+	string->data = data;
+	string->length = length;
+
 	return true;
 }
 
-bool writePackedString(char *string, FILE *stream)
+bool readPackedUInt16(struct IPConfigInput *input, uint16_t *value)
 {
-	size_t stringLength = strlen(string);
+	uint16_t buffer = 0; 
 
-	if (!writePackedUInt16(stringLength, stream))
+	if (!readPackedBytes(input, &buffer, sizeof buffer))
 	{
 		return false;
 	}
 
-	return fwrite(string, stringLength, 1, stream) == 1;
+	*value = convertBigEndianUInt16(buffer);
+	return true;
 }
 
-bool writePackedUInt16(uint16_t value, FILE *stream)
+bool readPackedUInt32(struct IPConfigInput *input, uint32_t *value)
 {
-	uint16_t buffer = convertBigEndianUInt16(value);
-	return fwrite(&buffer, sizeof buffer, 1, stream) == 1;
+	uint32_t buffer = 0; 
+
+	if (!readPackedBytes(input, &buffer, sizeof buffer))
+	{
+		return false;
+	}
+
+	*value = convertBigEndianUInt32(buffer);
+	return true;
 }
 
-bool writePackedUInt32(uint32_t value, FILE *stream)
+size_t measurePackedValue(enum IPConfigAttributeType type,
+                          union IPConfigValue *value)
 {
-	uint32_t buffer = convertBigEndianUInt32(value);
-	return fwrite(&buffer, sizeof buffer, 1, stream) == 1;
+	switch (type)
+	{
+		case IntegerIPConfigAttributeType:
+			return sizeof value->integer;
+
+		case StringIPConfigAttributeType:
+			return measurePackedString(&value->string);
+
+		case LinkIPConfigAttributeType:
+			return measurePackedLink(&value->link);
+
+		case RouteIPConfigAttributeType:
+			return measurePackedRoute(&value->route);
+
+		default:
+			return 0;
+	}
 }
 
-bool readUnpackedLine(FILE *stream, char **line)
+size_t measurePackedRoute(struct IPConfigRoute *route)
 {
-	char *cursor = NULL;
+	struct IPConfigLink *destination = &route->destination;
+	size_t size = 2 * sizeof(uint32_t);
 
-	*line = calloc(1, BUFSIZ);
+	if (destination->address.data && destination->prefix)
+	{
+		size += measurePackedLink(destination);
+	}
 
-	if (!*line)
+	if (route->nextHop.data)
 	{
-		return false;
+		size += measurePackedString(&route->nextHop);
 	}
-	
-	cursor = *line;
 
-	while (cursor - *line < BUFSIZ)
+	return size;
+}
+
+size_t measurePackedLink(struct IPConfigLink *link)
+{
+	return measurePackedString(&link->address) + sizeof(uint32_t);
+}
+
+size_t measurePackedString(struct IPConfigString *string)
+{
+	return sizeof(uint16_t) + string->length;
+}
+
+unsigned char *encodePackedValue(enum IPConfigAttributeType type,
+                                 union IPConfigValue *value,
+                                 unsigned char *cursor)
+{
+	switch (type)
 	{
-		int character = fgetc(stream);
+		case IntegerIPConfigAttributeType:
+			return encodePackedUInt32(value->integer, cursor);
 
-		if (character == EOF || character == '\n')
-		{
-			break;
-		}
+		case StringIPConfigAttributeType:
+			return encodePackedString(&value->string, cursor);
 
-		*cursor++ = character;
-	}
+		case LinkIPConfigAttributeType:
+			return encodePackedLink(&value->link, cursor);
 
-	return true;
+		case RouteIPConfigAttributeType:
+			return encodePackedRoute(&value->route, cursor);
+
+		default:
+			return cursor;
+	}
 }
 
-bool parseUnpackedPair(char *line, char **key, char **value)
+unsigned char *encodePackedRoute(struct IPConfigRoute *route,
+                                 unsigned char *cursor)
 {
-	char *next = index(line, ':');
+	struct IPConfigLink *destination = &route->destination;
 
-	if (!next)
+	if (destination->address.data && destination->prefix)
 	{
-		return false;
+		cursor = encodePackedUInt32(1, cursor);
+		cursor = encodePackedLink(destination, cursor);
 	}
 
-	*key = strndup(line, next - line);
+	else
+	{
+		cursor = encodePackedUInt32(0, cursor);
+	}
 
-	if (!*key)
+	if (route->nextHop.data)
 	{
-		return false;
+		cursor = encodePackedUInt32(1, cursor);
+		cursor = encodePackedString(&route->nextHop, cursor);
 	}
 
-	while (*++next && isspace(*next));
-	*value = strdup(next);
+	else
+	{
+		cursor = encodePackedUInt32(0, cursor);
+	}
+
+	return cursor;
+}
+
+unsigned char *encodePackedLink(struct IPConfigLink *link,
+                                unsigned char *cursor)
+{
+	cursor = encodePackedString(&link->address, cursor);
+	return encodePackedUInt32(link->prefix, cursor);
+}
+
+unsigned char *encodePackedString(struct IPConfigString *string,
+                                  unsigned char *cursor)
+{
+	cursor = encodePackedUInt16(string->length, cursor);
 
-	if (!*value)
+	if (string->length)
 	{
-		free(*key);
-		return false;
+		memcpy(cursor, string->data, string->length);
 	}
 
-	return true;
+	return cursor + string->length;
 }
 
-bool parseUnpackedRoute(char *string, struct IPConfigRoute *route)
+unsigned char *encodePackedUInt16(uint16_t value, unsigned char *cursor)
 {
-	char *next = index(string, ' ');
+	uint16_t buffer = convertBigEndianUInt16(value);
 
-	if (next)
+	memcpy(cursor, &buffer, sizeof buffer);
+	return cursor + sizeof buffer;
+}
+
+unsigned char *encodePackedUInt32(uint32_t value, unsigned char *cursor)
+{
+	uint32_t buffer = convertBigEndianUInt32(value);
+
+	memcpy(cursor, &buffer, sizeof buffer);
+	return cursor + sizeof buffer;
+}
+
+bool writeDescriptor(int descriptor, const void *data, size_t size)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		WriteIPConfigStatsPhase);
+	const unsigned char *cursor = data;
+
+	while (size)
 	{
-		*next = 0;
+		ssize_t written = write(descriptor, cursor, size);
 
-		if (!parseUnpackedLink(string, &route->destination))
+		if (written == -1)
 		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			printLibraryError("write");
+			enterIPConfigStatsPhase(phase);
 			return false;
 		}
 
-		string = ++next;
+		cursor += written;
+		size -= written;
 	}
 
-	route->nextHop = strdup(string);
+	enterIPConfigStatsPhase(phase);
+	return true;
+}
+
+void *readDescriptor(int descriptor, size_t *size)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		ReadIPConfigStatsPhase);
+	size_t capacity = BUFSIZ;
+	unsigned char *buffer = NULL;
+
+	*size = 0;
 
-	if (!route->nextHop)
+	for (;;)
 	{
-		return false;
-	}
+		ssize_t count = 0;
 
-	return true;
+		if (!buffer || *size == capacity)
+		{
+			unsigned char *grown = NULL;
+
+			capacity = buffer ? capacity * 2 : capacity;
+			grown = realloc(buffer, capacity);
+
+			if (!grown)
+			{
+				printLibraryError("realloc");
+				free(buffer);
+				enterIPConfigStatsPhase(phase);
+				return NULL;
+			}
+
+			countIPConfigAllocation(capacity);
+			buffer = grown;
+		}
+
+		count = read(descriptor, buffer + *size, capacity - *size);
+
+		if (count == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			printLibraryError("read");
+			free(buffer);
+			enterIPConfigStatsPhase(phase);
+			return NULL;
+		}
+
+		if (!count)
+		{
+			enterIPConfigStatsPhase(phase);
+			return buffer;
+		}
+
+		*size += count;
+	}
 }
 
-bool parseUnpackedLink(char *string, struct IPConfigLink *link)
+bool hasFileContents(const char *path, const void *data, size_t size)
 {
-	char *next = index(string, '/');
+	int descriptor = open(path, O_RDONLY);
+	struct stat status;
+	void *mapping = NULL;
+	bool same = false;
 
-	if (!next)
+	if (descriptor == -1)
 	{
 		return false;
 	}
 
-	link->address = strndup(string, next - string);
-
-	if (!link->address)
+	if (fstat(descriptor, &status) == -1 || !S_ISREG(status.st_mode) ||
+	    (size_t) status.st_size != size)
 	{
+		close(descriptor);
 		return false;
 	}
 
-	if (!parseUnpackedUInt32(++next, &link->prefix))
+	if (!size)
+	{
+		close(descriptor);
+		return true;
+	}
+
+	mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+
+	if (mapping == MAP_FAILED)
 	{
-		free(link->address);
 		return false;
 	}
 
-	return true;
+	same = !memcmp(mapping, data, size);
+	munmap(mapping, size);
+
+	return same;
 }
 
-bool parseUnpackedUInt32(char *string, uint32_t *integer)
+static bool syncDirectory(const char *path)
 {
-	char *terminator = NULL;
-	unsigned long value = strtoul(string, &terminator, 10);
+	const char *separator = strrchr(path, '/');
+	char *directory = NULL;
+	int descriptor = -1;
+	bool synced = false;
 
-	if (*terminator)
+	if (!separator)
+	{
+		directory = strdup(".");
+	}
+
+	else
+	{
+		directory = strndup(path, separator == path ? 1 : separator - path);
+	}
+
+	if (!directory)
 	{
+		printLibraryError("strdup");
 		return false;
 	}
 
-	*integer = value % UINT32_MAX;
+	if ((descriptor = open(directory, O_RDONLY | O_DIRECTORY)) == -1 ||
+	    fsync(descriptor) == -1)
+	{
+		printLibraryError(directory);
+	}
+
+	else
+	{
+		synced = true;
+	}
+
+	if (descriptor != -1)
+	{
+		close(descriptor);
+	}
+
+	free(directory);
+	return synced;
+}
+
+/*
+ * A new file gets the mode open() would give it, 0666 less the umask.  The
+ * umask can only be read by setting it, so that is done once; the only
+ * files created meanwhile come from mkstemp, whose 0600 a zero mask keeps.
+ */
+
+static mode_t IPConfigCreationMode = 0;
+static pthread_once_t IPConfigCreationModeOnce = PTHREAD_ONCE_INIT;
+
+static void readCreationMode(void)
+{
+	mode_t mask = umask(0);
+
+	umask(mask);
+	IPConfigCreationMode = 0666 & ~mask;
+}
+
+static mode_t getCreationMode(const char *path)
+{
+	struct stat status;
+
+	if (stat(path, &status) == 0)
+	{
+		return status.st_mode & 07777;
+	}
+
+	pthread_once(&IPConfigCreationModeOnce, readCreationMode);
+
+	return IPConfigCreationMode;
+}
+
+/*
+ * Unchanged contents leave the file alone.  Otherwise they are written to
+ * a temporary file beside it, synced and renamed over it, so that a reader
+ * sees either the old file or the new one and never a partial write.
+ */
+
+bool replaceFileIfChanged(const char *path, const void *data, size_t size,
+                          bool *replaced)
+{
+	size_t length = strlen(path) + sizeof ".XXXXXX";
+	char *temporaryPath = NULL;
+	int descriptor = -1;
+	bool written = false;
+
+	*replaced = false;
+
+	if (hasFileContents(path, data, size))
+	{
+		return true;
+	}
+
+	if (!(temporaryPath = malloc(length)))
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	snprintf(temporaryPath, length, "%s.XXXXXX", path);
+
+	if ((descriptor = mkstemp(temporaryPath)) == -1)
+	{
+		printLibraryError(temporaryPath);
+		free(temporaryPath);
+		return false;
+	}
+
+	written = writeDescriptor(descriptor, data, size);
+
+	if (written && (fchmod(descriptor, getCreationMode(path)) == -1 ||
+	                fsync(descriptor) == -1))
+	{
+		printLibraryError(temporaryPath);
+		written = false;
+	}
+
+	if (close(descriptor) == -1 && written)
+	{
+		printLibraryError(temporaryPath);
+		written = false;
+	}
+
+	if (written && rename(temporaryPath, path) == -1)
+	{
+		printLibraryError(path);
+		written = false;
+	}
+
+	if (!written)
+	{
+		unlink(temporaryPath);
+		free(temporaryPath);
+		return false;
+	}
+
+	free(temporaryPath);
+	*replaced = true;
+
+	return syncDirectory(path);
+}
+
+static bool fillUnpackedInput(struct IPConfigScanner *scanner)
+{
+	enum IPConfigStatsPhase phase = NoIPConfigStatsPhase;
+	size_t count = 0;
+
+	if (scanner->start)
+	{
+		memmove(scanner->buffer, scanner->buffer + scanner->start,
+		        scanner->end - scanner->start);
+
+		scanner->end -= scanner->start;
+		scanner->start = 0;
+	}
+
+	if (scanner->end + 1 >= scanner->capacity)
+	{
+		size_t capacity = scanner->capacity * 2;
+		char *buffer = realloc(scanner->buffer, capacity);
+
+		if (!buffer)
+		{
+			scanner->failed = true;
+			return false;
+		}
+
+		countIPConfigAllocation(capacity);
+		scanner->buffer = buffer;
+		scanner->capacity = capacity;
+	}
+
+	phase = enterIPConfigStatsPhase(ReadIPConfigStatsPhase);
+	count = fread(scanner->buffer + scanner->end, 1,
+	              scanner->capacity - scanner->end - 1, scanner->stream);
+	enterIPConfigStatsPhase(phase);
+	countIPConfigBytesRead(count);
+
+	if (!count)
+	{
+		scanner->finished = true;
+		scanner->failed = ferror(scanner->stream);
+
+		return !scanner->failed;
+	}
+
+	scanner->end += count;
+	return true;
+}
+
+bool isUnpackedInputFinished(struct IPConfigScanner *scanner)
+{
+	while (scanner->start == scanner->end)
+	{
+		if (scanner->finished || !fillUnpackedInput(scanner))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool readUnpackedLine(struct IPConfigScanner *scanner,
+                      char **line, size_t *length)
+{
+	size_t scanned = 0;
+
+	for (;;)
+	{
+		char *start = scanner->buffer + scanner->start;
+		size_t available = scanner->end - scanner->start;
+		char *newline = memchr(start + scanned, '\n',
+		                       available - scanned);
+
+		if (newline)
+		{
+			*newline = 0;
+			*line = start;
+			*length = newline - start;
+			scanner->start += *length + 1;
+
+			return true;
+		}
+
+		if (scanner->finished)
+		{
+			start[available] = 0;
+			*line = start;
+			*length = available;
+			scanner->start = scanner->end;
+
+			return true;
+		}
+
+		scanned = available;
+
+		if (!fillUnpackedInput(scanner))
+		{
+			return false;
+		}
+	}
+}
+
+bool parseUnpackedPair(char *line, char **key, char **value)
+{
+	char *next = index(line, ':');
+
+	if (!next)
+	{
+		return false;
+	}
+
+	*next = 0;
+	*key = line;
+
+	while (*++next && isspace(*next));
+	*value = next;
+
+	return true;
+}
+
+bool parseUnpackedValue(char *string, struct IPConfigArena *arena,
+                        enum IPConfigAttributeType type,
+                        union IPConfigValue *value)
+{
+	switch (type)
+	{
+		case IntegerIPConfigAttributeType:
+			return parseUnpackedUInt32(string, &value->integer);
+
+		case StringIPConfigAttributeType:
+			value->string.length = strlen(string);
+			value->string.data = duplicateIPConfigArenaString(
+				arena, string, value->string.length);
+
+			return value->string.data != NULL;
+
+		case LinkIPConfigAttributeType:
+			return parseUnpackedLink(string, arena, &value->link);
+
+		case RouteIPConfigAttributeType:
+			return parseUnpackedRoute(string, arena, &value->route);
+
+		default:
+			return false;
+	}
+}
+
+bool parseUnpackedRoute(char *string, struct IPConfigArena *arena,
+                        struct IPConfigRoute *route)
+{
+	char *next = index(string, ' ');
+
+	if (next)
+	{
+		*next = 0;
+
+		if (!parseUnpackedLink(string, arena, &route->destination))
+		{
+			return false;
+		}
+
+		string = ++next;
+	}
+
+	route->nextHop.length = strlen(string);
+	route->nextHop.data = duplicateIPConfigArenaString(arena, string,
+	                                                   route->nextHop.length);
+
+	if (!route->nextHop.data)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool parseUnpackedLink(char *string, struct IPConfigArena *arena,
+                       struct IPConfigLink *link)
+{
+	char *next = index(string, '/');
+
+	if (!next)
+	{
+		return false;
+	}
+
+	link->address.length = next - string;
+	link->address.data = duplicateIPConfigArenaString(arena, string,
+	                                                  link->address.length);
+
+	if (!link->address.data)
+	{
+		return false;
+	}
+
+	if (!parseUnpackedUInt32(++next, &link->prefix))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool parseUnpackedUInt32(char *string, uint32_t *integer)
+{
+	char *terminator = NULL;
+	unsigned long value = strtoul(string, &terminator, 10);
+
+	if (*terminator)
+	{
+		return false;
+	}
+
+	*integer = value % UINT32_MAX;
+	return true;
+}
+
+/*
+ * Values are hashed with FNV-1a, starting from IPConfigHashBasis, for the
+ * in-memory tables that pair records and attributes.  A route without a
+ * destination hashes as its next hop alone.
+ */
+
+uint32_t hashIPConfigBytes(uint32_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = data;
+
+	for (size_t index = 0; index < size; index++)
+	{
+		hash = (hash ^ bytes[index]) * 16777619u;
+	}
+
+	return hash;
+}
+
+uint32_t hashIPConfigString(uint32_t hash,
+                            const struct IPConfigString *string)
+{
+	return hashIPConfigBytes(hash ^ string->length, string->data,
+	                         string->length);
+}
+
+uint32_t hashIPConfigValue(uint32_t hash, enum IPConfigAttributeType type,
+                           const union IPConfigValue *value)
+{
+	const struct IPConfigRoute *route = &value->route;
+
+	switch (type)
+	{
+		case IntegerIPConfigAttributeType:
+			return hashIPConfigBytes(hash, &value->integer,
+			                         sizeof value->integer);
+
+		case StringIPConfigAttributeType:
+			return hashIPConfigString(hash, &value->string);
+
+		case LinkIPConfigAttributeType:
+			hash = hashIPConfigString(hash, &value->link.address);
+			return hashIPConfigBytes(hash, &value->link.prefix,
+			                         sizeof value->link.prefix);
+
+		case RouteIPConfigAttributeType:
+			if (route->destination.address.data &&
+			    route->destination.prefix)
+			{
+				hash = hashIPConfigString(hash,
+				                          &route->destination.address);
+				hash = hashIPConfigBytes(hash, &route->destination.prefix,
+				                         sizeof route->destination.prefix);
+			}
+
+			return hashIPConfigString(hash, &route->nextHop);
+
+		default:
+			return hash;
+	}
+}
+
+/*
+ * JSON is encoded in one pass into a buffer sized by an upper bound, which
+ * allows for every byte of every string needing a six byte escape.
+ */
+
+static const size_t IPConfigJSONLinkOverhead = sizeof
+	"{\"address\":,\"prefix\":4294967295}";
+static const size_t IPConfigJSONRouteOverhead = sizeof
+	"{\"destination\":,\"nextHop\":}";
+
+size_t boundJSONString(const struct IPConfigString *string)
+{
+	return string->length * 6 + 2 + sizeof "null";
+}
+
+size_t boundJSONValue(enum IPConfigAttributeType type,
+                      const union IPConfigValue *value)
+{
+	switch (type)
+	{
+		case IntegerIPConfigAttributeType:
+			return sizeof "4294967295";
+
+		case StringIPConfigAttributeType:
+			return boundJSONString(&value->string);
+
+		case LinkIPConfigAttributeType:
+			return IPConfigJSONLinkOverhead +
+			       boundJSONString(&value->link.address);
+
+		case RouteIPConfigAttributeType:
+			return IPConfigJSONRouteOverhead + IPConfigJSONLinkOverhead +
+			       boundJSONString(&value->route.destination.address) +
+			       boundJSONString(&value->route.nextHop);
+
+		default:
+			return sizeof "null";
+	}
+}
+
+char *encodeJSONBytes(const void *bytes, size_t size, char *cursor)
+{
+	memcpy(cursor, bytes, size);
+	return cursor + size;
+}
+
+char *encodeJSONString(const struct IPConfigString *string, char *cursor)
+{
+	static const char hexadecimal[] = "0123456789abcdef";
+	const unsigned char *data = (const unsigned char *) string->data;
+
+	if (!data)
+	{
+		return encodeJSONBytes("null", 4, cursor);
+	}
+
+	*cursor++ = '"';
+
+	for (size_t index = 0; index < string->length; index++)
+	{
+		unsigned char character = data[index];
+
+		if (character >= 0x20 && character != '"' && character != '\\')
+		{
+			*cursor++ = character;
+		}
+
+		else if (character == '"' || character == '\\')
+		{
+			*cursor++ = '\\';
+			*cursor++ = character;
+		}
+
+		else if (character == '\n')
+		{
+			*cursor++ = '\\';
+			*cursor++ = 'n';
+		}
+
+		else if (character == '\t')
+		{
+			*cursor++ = '\\';
+			*cursor++ = 't';
+		}
+
+		else
+		{
+			cursor = encodeJSONBytes("\\u00", 4, cursor);
+			*cursor++ = hexadecimal[character >> 4];
+			*cursor++ = hexadecimal[character & 0xf];
+		}
+	}
+
+	*cursor++ = '"';
+	return cursor;
+}
+
+char *encodeJSONUInt32(uint32_t value, char *cursor)
+{
+	char buffer[sizeof "4294967295"];
+	size_t start = sizeof buffer;
+
+	do
+	{
+		buffer[--start] = '0' + value % 10;
+		value /= 10;
+	}
+	while (value);
+
+	return encodeJSONBytes(buffer + start, sizeof buffer - start, cursor);
+}
+
+char *encodeJSONLink(const struct IPConfigLink *link, char *cursor)
+{
+	cursor = encodeJSONBytes("{\"address\":", 11, cursor);
+	cursor = encodeJSONString(&link->address, cursor);
+	cursor = encodeJSONBytes(",\"prefix\":", 10, cursor);
+	cursor = encodeJSONUInt32(link->prefix, cursor);
+	*cursor++ = '}';
+
+	return cursor;
+}
+
+char *encodeJSONValue(enum IPConfigAttributeType type,
+                      const union IPConfigValue *value, char *cursor)
+{
+	const struct IPConfigRoute *route = &value->route;
+
+	switch (type)
+	{
+		case IntegerIPConfigAttributeType:
+			return encodeJSONUInt32(value->integer, cursor);
+
+		case StringIPConfigAttributeType:
+			return encodeJSONString(&value->string, cursor);
+
+		case LinkIPConfigAttributeType:
+			return encodeJSONLink(&value->link, cursor);
+
+		case RouteIPConfigAttributeType:
+			cursor = encodeJSONBytes("{\"destination\":", 15, cursor);
+
+			if (route->destination.address.data)
+			{
+				cursor = encodeJSONLink(&route->destination, cursor);
+			}
+
+			else
+			{
+				cursor = encodeJSONBytes("null", 4, cursor);
+			}
+
+			cursor = encodeJSONBytes(",\"nextHop\":", 11, cursor);
+			cursor = encodeJSONString(&route->nextHop, cursor);
+			*cursor++ = '}';
+
+			return cursor;
+
+		default:
+			return encodeJSONBytes("null", 4, cursor);
+	}
+}
+
+void skipJSONSpace(char **cursor)
+{
+	while (**cursor == ' ' || **cursor == '\t' || **cursor == '\r' ||
+	       **cursor == '\n')
+	{
+		++*cursor;
+	}
+}
+
+bool parseJSONCharacter(char **cursor, char character)
+{
+	skipJSONSpace(cursor);
+
+	if (**cursor != character)
+	{
+		return false;
+	}
+
+	++*cursor;
+	return true;
+}
+
+bool parseJSONNull(char **cursor)
+{
+	skipJSONSpace(cursor);
+
+	if (strncmp(*cursor, "null", 4))
+	{
+		return false;
+	}
+
+	*cursor += 4;
+	return true;
+}
+
+static bool parseJSONHexadecimal(const char *digits, uint32_t *value)
+{
+	*value = 0;
+
+	for (size_t index = 0; index < 4; index++)
+	{
+		int digit = (unsigned char) digits[index];
+
+		if (!isxdigit(digit))
+		{
+			return false;
+		}
+
+		*value = *value << 4 |
+		         (isdigit(digit) ? digit - '0' : (digit | 0x20) - 'a' + 10);
+	}
+
+	return true;
+}
+
+static bool parseJSONEscape(char **cursor, char **output)
+{
+	static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+	char *escape = *cursor + 1;
+	uint32_t code = 0;
+
+	for (size_t index = 0; index < sizeof escapes - 1; index += 2)
+	{
+		if (*escape == escapes[index])
+		{
+			*(*output)++ = escapes[index + 1];
+			*cursor = escape + 1;
+			return true;
+		}
+	}
+
+	if (*escape != 'u' || !parseJSONHexadecimal(escape + 1, &code))
+	{
+		return false;
+	}
+
+	*cursor = escape + 5;
+
+	if (code >= 0xd800 && code < 0xdc00)
+	{
+		uint32_t low = 0;
+
+		if ((*cursor)[0] != '\\' || (*cursor)[1] != 'u' ||
+		    !parseJSONHexadecimal(*cursor + 2, &low) ||
+		    low < 0xdc00 || low >= 0xe000)
+		{
+			return false;
+		}
+
+		code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+		*cursor += 6;
+	}
+
+	else if (code >= 0xdc00 && code < 0xe000)
+	{
+		return false;
+	}
+
+	if (code < 0x80)
+	{
+		*(*output)++ = code;
+	}
+
+	else if (code < 0x800)
+	{
+		*(*output)++ = 0xc0 | code >> 6;
+		*(*output)++ = 0x80 | (code & 0x3f);
+	}
+
+	else if (code < 0x10000)
+	{
+		*(*output)++ = 0xe0 | code >> 12;
+		*(*output)++ = 0x80 | (code >> 6 & 0x3f);
+		*(*output)++ = 0x80 | (code & 0x3f);
+	}
+
+	else
+	{
+		*(*output)++ = 0xf0 | code >> 18;
+		*(*output)++ = 0x80 | (code >> 12 & 0x3f);
+		*(*output)++ = 0x80 | (code >> 6 & 0x3f);
+		*(*output)++ = 0x80 | (code & 0x3f);
+	}
+
+	return true;
+}
+
+/*
+ * Strings are unescaped where they lie, which never makes them longer, so
+ * the result points into the caller's line until it is copied.
+ */
+
+bool parseJSONString(char **cursor, struct IPConfigString *string)
+{
+	char *output = NULL;
+
+	if (!parseJSONCharacter(cursor, '"'))
+	{
+		return false;
+	}
+
+	output = *cursor;
+	string->data = output;
+
+	while (**cursor != '"')
+	{
+		if ((unsigned char) **cursor < 0x20)
+		{
+			return false;
+		}
+
+		if (**cursor == '\\')
+		{
+			if (!parseJSONEscape(cursor, &output))
+			{
+				return false;
+			}
+		}
+
+		else
+		{
+			*output++ = *(*cursor)++;
+		}
+	}
+
+	string->length = output - string->data;
+	++*cursor;
+
+	return true;
+}
+
+bool parseJSONUInt32(char **cursor, uint32_t *integer)
+{
+	uint64_t value = 0;
+	char *start = NULL;
+
+	skipJSONSpace(cursor);
+	start = *cursor;
+
+	while (isdigit((unsigned char) **cursor))
+	{
+		value = value * 10 + *(*cursor)++ - '0';
+
+		if (value > UINT32_MAX)
+		{
+			return false;
+		}
+	}
+
+	if (*cursor == start || (*start == '0' && *cursor - start > 1))
+	{
+		return false;
+	}
+
+	*integer = value;
+	return true;
+}
+
+static bool copyJSONString(struct IPConfigArena *arena,
+                           struct IPConfigString *string)
+{
+	string->data = duplicateIPConfigArenaString(arena, string->data,
+	                                            string->length);
+	return string->data != NULL;
+}
+
+/*
+ * Links and routes are objects whose members may come in any order; a
+ * missing destination or next hop is the same as null.
+ */
+
+bool parseJSONLink(char **cursor, struct IPConfigArena *arena,
+                   struct IPConfigLink *link)
+{
+	bool first = true;
+
+	if (!parseJSONCharacter(cursor, '{'))
+	{
+		return false;
+	}
+
+	while (!parseJSONCharacter(cursor, '}'))
+	{
+		struct IPConfigString name;
+
+		if ((!first && !parseJSONCharacter(cursor, ',')) ||
+		    !parseJSONString(cursor, &name) ||
+		    !parseJSONCharacter(cursor, ':'))
+		{
+			return false;
+		}
+
+		first = false;
+
+		if (name.length == 7 && !memcmp(name.data, "address", 7))
+		{
+			if (!parseJSONString(cursor, &link->address) ||
+			    !copyJSONString(arena, &link->address))
+			{
+				return false;
+			}
+		}
+
+		else if (name.length == 6 && !memcmp(name.data, "prefix", 6))
+		{
+			if (!parseJSONUInt32(cursor, &link->prefix))
+			{
+				return false;
+			}
+		}
+
+		else
+		{
+			return false;
+		}
+	}
+
+	return link->address.data != NULL;
+}
+
+bool parseJSONRoute(char **cursor, struct IPConfigArena *arena,
+                    struct IPConfigRoute *route)
+{
+	bool first = true;
+
+	if (!parseJSONCharacter(cursor, '{'))
+	{
+		return false;
+	}
+
+	while (!parseJSONCharacter(cursor, '}'))
+	{
+		struct IPConfigString name;
+
+		if ((!first && !parseJSONCharacter(cursor, ',')) ||
+		    !parseJSONString(cursor, &name) ||
+		    !parseJSONCharacter(cursor, ':'))
+		{
+			return false;
+		}
+
+		first = false;
+
+		if (name.length == 11 && !memcmp(name.data, "destination", 11))
+		{
+			if (!parseJSONNull(cursor) &&
+			    !parseJSONLink(cursor, arena, &route->destination))
+			{
+				return false;
+			}
+		}
+
+		else if (name.length == 7 && !memcmp(name.data, "nextHop", 7))
+		{
+			if (!parseJSONNull(cursor) &&
+			    (!parseJSONString(cursor, &route->nextHop) ||
+			     !copyJSONString(arena, &route->nextHop)))
+			{
+				return false;
+			}
+		}
+
+		else
+		{
+			return false;
+		}
+	}
+
 	return true;
 }
@@ -5,27 +5,100 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "arena.h"
 #include "ipconfig.h"
 
+#define IPConfigScratchCapacity 32
+#define IPConfigHashBasis 2166136261u
+
 uint16_t convertBigEndianUInt16(uint16_t value);
 uint32_t convertBigEndianUInt32(uint32_t value);
 
-bool readPackedRoute(FILE *stream, struct IPConfigRoute *route);
-bool readPackedLink(FILE *stream, struct IPConfigLink *link);
-bool readPackedString(FILE *stream, char **string);
-bool readPackedUInt16(FILE *stream, uint16_t *value);
-bool readPackedUInt32(FILE *stream, uint32_t *value);
+bool isPackedInputFinished(struct IPConfigInput *input);
+
+bool readPackedValue(struct IPConfigInput *input,
+                     enum IPConfigAttributeType type,
+                     union IPConfigValue *value);
+bool readPackedRoute(struct IPConfigInput *input, struct IPConfigRoute *route);
+bool readPackedLink(struct IPConfigInput *input, struct IPConfigLink *link);
+bool readPackedStringLength(struct IPConfigInput *input, uint16_t *length);
+bool readPackedString(struct IPConfigInput *input,
+                      struct IPConfigString *string);
+bool readPackedStringInto(struct IPConfigInput *input,
+                          char *buffer, size_t capacity,
+                          struct IPConfigString *string);
+bool skipPackedString(struct IPConfigInput *input);
+bool skipPackedValue(struct IPConfigInput *input,
+                     enum IPConfigAttributeType type);
+bool matchPackedString(struct IPConfigInput *input,
+                       const char *expected, size_t expectedLength,
+                       bool *matched);
+
+bool readPackedUInt16(struct IPConfigInput *input, uint16_t *value);
+bool readPackedUInt32(struct IPConfigInput *input, uint32_t *value);
+
+size_t measurePackedValue(enum IPConfigAttributeType type,
+                          union IPConfigValue *value);
+size_t measurePackedRoute(struct IPConfigRoute *route);
+size_t measurePackedLink(struct IPConfigLink *link);
+size_t measurePackedString(struct IPConfigString *string);
+
+unsigned char *encodePackedValue(enum IPConfigAttributeType type,
+                                 union IPConfigValue *value,
+                                 unsigned char *cursor);
+unsigned char *encodePackedRoute(struct IPConfigRoute *route,
+                                 unsigned char *cursor);
+unsigned char *encodePackedLink(struct IPConfigLink *link,
+                                unsigned char *cursor);
+unsigned char *encodePackedString(struct IPConfigString *string,
+                                  unsigned char *cursor);
+unsigned char *encodePackedUInt16(uint16_t value, unsigned char *cursor);
+unsigned char *encodePackedUInt32(uint32_t value, unsigned char *cursor);
 
-bool writePackedRoute(struct IPConfigRoute *route, FILE *stream);
-bool writePackedLink(struct IPConfigLink *link, FILE *stream);
-bool writePackedString(char *string, FILE *stream);
-bool writePackedUInt16(uint16_t value, FILE *stream);
-bool writePackedUInt32(uint32_t value, FILE *stream);
+void *readDescriptor(int descriptor, size_t *size);
+bool writeDescriptor(int descriptor, const void *data, size_t size);
+bool hasFileContents(const char *path, const void *data, size_t size);
+bool replaceFileIfChanged(const char *path, const void *data, size_t size,
+                          bool *replaced);
 
-bool readUnpackedLine(FILE *stream, char **line);
+bool isUnpackedInputFinished(struct IPConfigScanner *scanner);
+bool readUnpackedLine(struct IPConfigScanner *scanner,
+                      char **line, size_t *length);
 bool parseUnpackedPair(char *line, char **key, char **value);
-bool parseUnpackedRoute(char *string, struct IPConfigRoute *route);
-bool parseUnpackedLink(char *string, struct IPConfigLink *link);
+bool parseUnpackedValue(char *string, struct IPConfigArena *arena,
+                        enum IPConfigAttributeType type,
+                        union IPConfigValue *value);
+bool parseUnpackedRoute(char *string, struct IPConfigArena *arena,
+                        struct IPConfigRoute *route);
+bool parseUnpackedLink(char *string, struct IPConfigArena *arena,
+                       struct IPConfigLink *link);
 bool parseUnpackedUInt32(char *string, uint32_t *integer);
 
+uint32_t hashIPConfigBytes(uint32_t hash, const void *data, size_t size);
+uint32_t hashIPConfigString(uint32_t hash,
+                            const struct IPConfigString *string);
+uint32_t hashIPConfigValue(uint32_t hash, enum IPConfigAttributeType type,
+                           const union IPConfigValue *value);
+
+size_t boundJSONString(const struct IPConfigString *string);
+size_t boundJSONValue(enum IPConfigAttributeType type,
+                      const union IPConfigValue *value);
+
+char *encodeJSONBytes(const void *bytes, size_t size, char *cursor);
+char *encodeJSONString(const struct IPConfigString *string, char *cursor);
+char *encodeJSONUInt32(uint32_t value, char *cursor);
+char *encodeJSONLink(const struct IPConfigLink *link, char *cursor);
+char *encodeJSONValue(enum IPConfigAttributeType type,
+                      const union IPConfigValue *value, char *cursor);
+
+void skipJSONSpace(char **cursor);
+bool parseJSONCharacter(char **cursor, char character);
+bool parseJSONNull(char **cursor);
+bool parseJSONString(char **cursor, struct IPConfigString *string);
+bool parseJSONUInt32(char **cursor, uint32_t *integer);
+bool parseJSONLink(char **cursor, struct IPConfigArena *arena,
+                   struct IPConfigLink *link);
+bool parseJSONRoute(char **cursor, struct IPConfigArena *arena,
+                    struct IPConfigRoute *route);
+
 #endif
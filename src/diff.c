@@ -0,0 +1,963 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "data.h"
+#include "diff.h"
+#include "ipconfig.h"
+#include "error.h"
+#include "schema.h"
+
+static const size_t IPConfigDiffMinimumCapacity = 16;
+static const uint32_t IPConfigDiffTextVersion = IPConfigSchemaVersionCount;
+
+struct IPConfigDiffAttribute
+{
+	struct IPConfigAttribute attribute;
+	uint32_t keyHash;
+	uint32_t hash;
+
+	size_t next;
+	size_t pending;
+	bool matched;
+};
+
+struct IPConfigDiffRecord
+{
+	size_t first;
+	size_t count;
+	size_t identifier;
+	bool identified;
+	uint32_t hash;
+
+	size_t next;
+	size_t pending;
+	bool matched;
+};
+
+struct IPConfigDiffSide
+{
+	FILE *stream;
+	struct IPConfigReader reader;
+	struct IPConfig config;
+	bool packed;
+
+	struct IPConfigArena arena;
+	struct IPConfigDiffAttribute *attributes;
+	size_t attributeCount;
+	size_t attributeCapacity;
+
+	struct IPConfigDiffRecord *records;
+	size_t recordCount;
+	size_t recordCapacity;
+	size_t largestRecord;
+	size_t position;
+};
+
+void initializeIPConfigDiff(struct IPConfigDiff *diff, FILE *stream)
+{
+	memset(diff, 0, sizeof *diff);
+	diff->stream = stream;
+}
+
+static void *reserveArray(void *array, size_t *capacity, size_t count,
+                          size_t size)
+{
+	size_t grown = *capacity;
+
+	if (count <= *capacity)
+	{
+		return array;
+	}
+
+	if (grown < IPConfigDiffMinimumCapacity)
+	{
+		grown = IPConfigDiffMinimumCapacity;
+	}
+
+	while (grown < count)
+	{
+		grown *= 2;
+	}
+
+	if (!(array = realloc(array, grown * size)))
+	{
+		printLibraryError("realloc");
+		return NULL;
+	}
+
+	*capacity = grown;
+	return array;
+}
+
+static size_t getSlotCount(size_t count)
+{
+	size_t slotCount = IPConfigDiffMinimumCapacity;
+
+	while (slotCount < count * 2)
+	{
+		slotCount *= 2;
+	}
+
+	return slotCount;
+}
+
+static bool isSameString(const struct IPConfigString *left,
+                         const struct IPConfigString *right)
+{
+	return left->length == right->length &&
+	       (!left->length || !memcmp(left->data, right->data, left->length));
+}
+
+static bool hasDestination(const struct IPConfigRoute *route)
+{
+	return route->destination.address.data && route->destination.prefix;
+}
+
+static bool isSameValue(enum IPConfigAttributeType type,
+                        const union IPConfigValue *left,
+                        const union IPConfigValue *right)
+{
+	if (type == IntegerIPConfigAttributeType)
+	{
+		return left->integer == right->integer;
+	}
+
+	else if (type == StringIPConfigAttributeType)
+	{
+		return isSameString(&left->string, &right->string);
+	}
+
+	else if (type == LinkIPConfigAttributeType)
+	{
+		return left->link.prefix == right->link.prefix &&
+		       isSameString(&left->link.address, &right->link.address);
+	}
+
+	else if (type == RouteIPConfigAttributeType)
+	{
+		const struct IPConfigLink *leftDestination =
+			&left->route.destination;
+		const struct IPConfigLink *rightDestination =
+			&right->route.destination;
+
+		if (hasDestination(&left->route) != hasDestination(&right->route))
+		{
+			return false;
+		}
+
+		if (hasDestination(&left->route) &&
+		    (leftDestination->prefix != rightDestination->prefix ||
+		     !isSameString(&leftDestination->address,
+		                   &rightDestination->address)))
+		{
+			return false;
+		}
+
+		return isSameString(&left->route.nextHop, &right->route.nextHop);
+	}
+
+	return true;
+}
+
+static bool isSameAttribute(const struct IPConfigAttribute *left,
+                            const struct IPConfigAttribute *right)
+{
+	return left->type == right->type &&
+	       isSameString(&left->key, &right->key) &&
+	       isSameValue(left->type, &left->value, &right->value);
+}
+
+static bool copyString(struct IPConfigArena *arena,
+                       struct IPConfigString *string)
+{
+	char *data = NULL;
+
+	if (!string->length)
+	{
+		string->data = string->data ? "" : NULL;
+		return true;
+	}
+
+	if (!(data = duplicateIPConfigArenaString(arena, string->data,
+	                                          string->length)))
+	{
+		return false;
+	}
+
+	string->data = data;
+	return true;
+}
+
+static bool copyAttribute(struct IPConfigArena *arena,
+                          struct IPConfigAttribute *attribute)
+{
+	union IPConfigValue *value = &attribute->value;
+
+	if (!copyString(arena, &attribute->key))
+	{
+		return false;
+	}
+
+	if (attribute->type == StringIPConfigAttributeType)
+	{
+		return copyString(arena, &value->string);
+	}
+
+	else if (attribute->type == LinkIPConfigAttributeType)
+	{
+		return copyString(arena, &value->link.address);
+	}
+
+	else if (attribute->type == RouteIPConfigAttributeType)
+	{
+		return copyString(arena, &value->route.destination.address) &&
+		       copyString(arena, &value->route.nextHop);
+	}
+
+	return true;
+}
+
+/*
+ * Records are decoded one at a time and copied out of the reader's arena,
+ * with a hash of each attribute and of the record id computed on the way.
+ */
+
+static bool appendRecord(struct IPConfigDiffSide *side)
+{
+	struct IPConfig *config = &side->config;
+	struct IPConfigDiffRecord *records = NULL;
+	struct IPConfigDiffAttribute *attributes = NULL;
+	struct IPConfigDiffRecord *record = NULL;
+
+	if (!(records = reserveArray(side->records, &side->recordCapacity,
+	                             side->recordCount + 1, sizeof *records)))
+	{
+		return false;
+	}
+
+	side->records = records;
+
+	if (!(attributes = reserveArray(side->attributes,
+	                                &side->attributeCapacity,
+	                                side->attributeCount +
+	                                config->attributeCount,
+	                                sizeof *attributes)))
+	{
+		return false;
+	}
+
+	side->attributes = attributes;
+
+	record = &side->records[side->recordCount++];
+	memset(record, 0, sizeof *record);
+	record->first = side->attributeCount;
+
+	for (size_t index = 0; index < config->attributeCount; index++)
+	{
+		struct IPConfigDiffAttribute *copy =
+			&side->attributes[side->attributeCount];
+
+		copy->attribute = config->attributes[index];
+		copy->matched = false;
+
+		if (copy->attribute.type == InvalidIPConfigAttributeType ||
+		    copy->attribute.type == TerminalIPConfigAttributeType)
+		{
+			continue;
+		}
+
+		if (!copyAttribute(&side->arena, &copy->attribute))
+		{
+			printLibraryError("malloc");
+			return false;
+		}
+
+		copy->keyHash = hashIPConfigString(IPConfigHashBasis,
+		                                   &copy->attribute.key);
+		copy->hash = hashIPConfigValue(copy->keyHash, copy->attribute.type,
+		                               &copy->attribute.value);
+
+		if (!record->identified &&
+		    isSameString(&copy->attribute.key, &IPConfigIdentifierKey))
+		{
+			record->identified = true;
+			record->identifier = side->attributeCount;
+			record->hash = hashIPConfigValue(IPConfigHashBasis,
+			                                 copy->attribute.type,
+			                                 &copy->attribute.value);
+		}
+
+		side->attributeCount++;
+	}
+
+	record->count = side->attributeCount - record->first;
+
+	if (record->count > side->largestRecord)
+	{
+		side->largestRecord = record->count;
+	}
+
+	return true;
+}
+
+static bool openSide(struct IPConfigDiffSide *side, const char *path)
+{
+	int first = 0;
+
+	if (!(side->stream = fopen(path, "r")))
+	{
+		printLibraryError(path);
+		return false;
+	}
+
+	first = getc(side->stream);
+	ungetc(first, side->stream);
+	side->packed = first == 0;
+
+	return !side->packed ||
+	       initializeMappedIPConfigReader(&side->reader, side->stream);
+}
+
+static bool startSide(struct IPConfigDiff *diff,
+                      struct IPConfigDiffSide *side, uint32_t version)
+{
+	if (!side->packed &&
+	    !initializeUnpackedIPConfigReader(&side->reader, side->stream,
+	                                      version))
+	{
+		return false;
+	}
+
+	side->reader.addressMode = diff->addressMode;
+	return true;
+}
+
+static enum IPConfigRecordStatus loadRecord(struct IPConfigDiffSide *side,
+                                            uint32_t version)
+{
+	enum IPConfigRecordStatus status = EndIPConfigRecordStatus;
+	size_t droppedCount = 0;
+	bool loaded = false;
+
+	status = readIPConfigRecord(&side->reader, &side->config);
+
+	if (status != ReadIPConfigRecordStatus)
+	{
+		return status;
+	}
+
+	loaded = (side->config.version == version ||
+	          transcodeIPConfig(&side->config, version, &droppedCount)) &&
+	         appendRecord(side);
+
+	resetIPConfig(&side->config);
+	return loaded ? status : FailedIPConfigRecordStatus;
+}
+
+static bool loadSide(struct IPConfigDiffSide *side, uint32_t version)
+{
+	enum IPConfigRecordStatus status = EndIPConfigRecordStatus;
+
+	while ((status = loadRecord(side, version)) == ReadIPConfigRecordStatus);
+
+	return status == EndIPConfigRecordStatus;
+}
+
+static void clearSide(struct IPConfigDiffSide *side)
+{
+	side->attributeCount = 0;
+	side->recordCount = 0;
+	side->largestRecord = 0;
+
+	resetIPConfigArena(&side->arena);
+}
+
+static void releaseSide(struct IPConfigDiffSide *side)
+{
+	deinitializeIPConfigArena(&side->arena);
+	free(side->attributes);
+	free(side->records);
+}
+
+static void deinitializeSide(struct IPConfigDiffSide *side)
+{
+	deinitializeIPConfigReader(&side->reader);
+	deinitializeIPConfig(&side->config);
+
+	if (side->stream)
+	{
+		fclose(side->stream);
+	}
+
+	releaseSide(side);
+}
+
+static bool isSameIdentifier(const struct IPConfigDiffSide *leftSide,
+                             const struct IPConfigDiffRecord *left,
+                             const struct IPConfigDiffSide *rightSide,
+                             const struct IPConfigDiffRecord *right)
+{
+	const struct IPConfigAttribute *leftId = NULL;
+	const struct IPConfigAttribute *rightId = NULL;
+
+	if (left->identified != right->identified || left->hash != right->hash)
+	{
+		return false;
+	}
+
+	if (!left->identified)
+	{
+		return true;
+	}
+
+	leftId = &leftSide->attributes[left->identifier].attribute;
+	rightId = &rightSide->attributes[right->identifier].attribute;
+
+	return leftId->type == rightId->type &&
+	       isSameValue(leftId->type, &leftId->value, &rightId->value);
+}
+
+static void writeLabel(struct IPConfigDiff *diff, char sign,
+                       struct IPConfigDiffSide *side,
+                       struct IPConfigDiffRecord *record)
+{
+	fprintf(diff->stream, "%c ", sign);
+
+	if (record->identified)
+	{
+		formatUnpackedIPConfigValue(
+			&side->attributes[record->identifier].attribute, diff->stream);
+	}
+
+	else
+	{
+		fprintf(diff->stream, "#%zu",
+		        side->position + (size_t) (record - side->records));
+	}
+}
+
+static void writeAttribute(struct IPConfigDiff *diff, char sign,
+                           struct IPConfigDiffSide *side,
+                           struct IPConfigDiffRecord *record,
+                           struct IPConfigAttribute *attribute,
+                           struct IPConfigAttribute *replacement)
+{
+	writeLabel(diff, sign, side, record);
+	fprintf(diff->stream, " %.*s: ", (int) attribute->key.length,
+	        attribute->key.data);
+	formatUnpackedIPConfigValue(attribute, diff->stream);
+
+	if (replacement)
+	{
+		fprintf(diff->stream, " -> ");
+		formatUnpackedIPConfigValue(replacement, diff->stream);
+	}
+
+	fputc('\n', diff->stream);
+}
+
+/*
+ * Identical attributes are paired through a hash table over the right
+ * record, so repeated keys such as dns may appear in any order.  The table
+ * is then refilled with what is left on the right, chained by key in
+ * record order, and whatever is left over on the left takes the first
+ * unpaired attribute with its key as a change, or is a removal.  Returns
+ * whether the comparison should go on.
+ */
+
+static bool compareRecords(struct IPConfigDiff *diff, size_t *slots,
+                           struct IPConfigDiffSide *leftSide,
+                           struct IPConfigDiffRecord *left,
+                           struct IPConfigDiffSide *rightSide,
+                           struct IPConfigDiffRecord *right)
+{
+	struct IPConfigDiffAttribute *leftAttributes =
+		&leftSide->attributes[left->first];
+	struct IPConfigDiffAttribute *rightAttributes =
+		&rightSide->attributes[right->first];
+	size_t mask = getSlotCount(right->count) - 1;
+	size_t unmatchedCount = left->count;
+
+	memset(slots, 0, (mask + 1) * sizeof *slots);
+
+	for (size_t index = 0; index < right->count; index++)
+	{
+		size_t slot = rightAttributes[index].hash & mask;
+
+		while (slots[slot])
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		slots[slot] = index + 1;
+	}
+
+	for (size_t index = 0; index < left->count; index++)
+	{
+		struct IPConfigDiffAttribute *attribute = &leftAttributes[index];
+
+		for (size_t slot = attribute->hash & mask; slots[slot];
+		     slot = (slot + 1) & mask)
+		{
+			struct IPConfigDiffAttribute *candidate =
+				&rightAttributes[slots[slot] - 1];
+
+			if (!candidate->matched && candidate->hash == attribute->hash &&
+			    isSameAttribute(&candidate->attribute,
+			                    &attribute->attribute))
+			{
+				candidate->matched = true;
+				attribute->matched = true;
+				unmatchedCount--;
+				break;
+			}
+		}
+	}
+
+	if (unmatchedCount)
+	{
+		memset(slots, 0, (mask + 1) * sizeof *slots);
+	}
+
+	for (size_t index = right->count; unmatchedCount && index-- > 0;)
+	{
+		struct IPConfigDiffAttribute *attribute = &rightAttributes[index];
+		size_t slot = attribute->keyHash & mask;
+
+		if (attribute->matched)
+		{
+			continue;
+		}
+
+		while (slots[slot] &&
+		       !isSameString(&rightAttributes[slots[slot] - 1].attribute.key,
+		                     &attribute->attribute.key))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		attribute->next = slots[slot];
+		attribute->pending = index + 1;
+		slots[slot] = index + 1;
+	}
+
+	for (size_t index = 0; index < left->count; index++)
+	{
+		struct IPConfigDiffAttribute *attribute = &leftAttributes[index];
+		struct IPConfigDiffAttribute *replacement = NULL;
+		size_t slot = attribute->keyHash & mask;
+
+		if (attribute->matched)
+		{
+			continue;
+		}
+
+		while (slots[slot] &&
+		       !isSameString(&rightAttributes[slots[slot] - 1].attribute.key,
+		                     &attribute->attribute.key))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		if (slots[slot])
+		{
+			struct IPConfigDiffAttribute *head =
+				&rightAttributes[slots[slot] - 1];
+
+			if (head->pending)
+			{
+				replacement = &rightAttributes[head->pending - 1];
+				head->pending = replacement->next;
+				replacement->matched = true;
+			}
+		}
+
+		if (replacement)
+		{
+			diff->changedCount++;
+		}
+
+		else
+		{
+			diff->removedCount++;
+		}
+
+		if (!diff->stream)
+		{
+			return false;
+		}
+
+		writeAttribute(diff, replacement ? '~' : '-', leftSide, left,
+		               &attribute->attribute,
+		               replacement ? &replacement->attribute : NULL);
+	}
+
+	for (size_t index = 0; index < right->count; index++)
+	{
+		if (rightAttributes[index].matched)
+		{
+			continue;
+		}
+
+		diff->addedCount++;
+
+		if (!diff->stream)
+		{
+			return false;
+		}
+
+		writeAttribute(diff, '+', rightSide, right,
+		               &rightAttributes[index].attribute, NULL);
+	}
+
+	return true;
+}
+
+/*
+ * Right records are entered into a table by id, with records that share an
+ * id chained in file order, so each left record finds its partner in
+ * constant time and duplicates pair up in order.  Records without an id
+ * share one chain and so are paired by position.
+ */
+
+static bool compareSides(struct IPConfigDiff *diff,
+                         struct IPConfigDiffSide *leftSide,
+                         struct IPConfigDiffSide *rightSide,
+                         size_t *recordSlots, size_t *attributeSlots)
+{
+	size_t mask = getSlotCount(rightSide->recordCount) - 1;
+
+	for (size_t index = rightSide->recordCount; index-- > 0;)
+	{
+		struct IPConfigDiffRecord *record = &rightSide->records[index];
+		size_t slot = record->hash & mask;
+
+		while (recordSlots[slot] &&
+		       !isSameIdentifier(rightSide,
+		                         &rightSide->records[recordSlots[slot] - 1],
+		                         rightSide, record))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		record->next = recordSlots[slot];
+		record->pending = index + 1;
+		recordSlots[slot] = index + 1;
+	}
+
+	for (size_t index = 0; index < leftSide->recordCount; index++)
+	{
+		struct IPConfigDiffRecord *left = &leftSide->records[index];
+		struct IPConfigDiffRecord *right = NULL;
+		size_t slot = left->hash & mask;
+
+		while (recordSlots[slot] &&
+		       !isSameIdentifier(leftSide, left, rightSide,
+		                         &rightSide->records[recordSlots[slot] - 1]))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		if (recordSlots[slot])
+		{
+			struct IPConfigDiffRecord *head =
+				&rightSide->records[recordSlots[slot] - 1];
+
+			if (head->pending)
+			{
+				right = &rightSide->records[head->pending - 1];
+				head->pending = right->next;
+				right->matched = true;
+			}
+		}
+
+		if (right)
+		{
+			if (!compareRecords(diff, attributeSlots, leftSide, left,
+			                    rightSide, right))
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		diff->removedCount++;
+
+		if (!diff->stream)
+		{
+			return false;
+		}
+
+		writeLabel(diff, '-', leftSide, left);
+		fputc('\n', diff->stream);
+	}
+
+	for (size_t index = 0; index < rightSide->recordCount; index++)
+	{
+		if (rightSide->records[index].matched)
+		{
+			continue;
+		}
+
+		diff->addedCount++;
+
+		if (!diff->stream)
+		{
+			return false;
+		}
+
+		writeLabel(diff, '+', rightSide, &rightSide->records[index]);
+		fputc('\n', diff->stream);
+	}
+
+	return true;
+}
+
+/*
+ * Without a stream only whether the sides differ matters, so records are
+ * first compared in pairs as they are read.  While both sides hold the
+ * same ids in the same order, each pair is the one the table would make,
+ * so a difference ends the comparison at once and equal pairs are dropped.
+ * The first pair that is out of step stays loaded for the table.
+ */
+
+static bool compareInStep(struct IPConfigDiff *diff,
+                          struct IPConfigDiffSide *leftSide,
+                          struct IPConfigDiffSide *rightSide,
+                          uint32_t version, bool *finished)
+{
+	size_t *slots = NULL;
+	size_t slotCapacity = 0;
+	bool compared = true;
+
+	*finished = true;
+
+	for (;;)
+	{
+		enum IPConfigRecordStatus leftStatus = loadRecord(leftSide, version);
+		enum IPConfigRecordStatus rightStatus = loadRecord(rightSide,
+		                                                   version);
+		struct IPConfigDiffRecord *left = leftSide->records;
+		struct IPConfigDiffRecord *right = rightSide->records;
+		size_t slotCount = 0;
+
+		if (leftStatus == FailedIPConfigRecordStatus ||
+		    rightStatus == FailedIPConfigRecordStatus)
+		{
+			compared = false;
+			break;
+		}
+
+		if (leftStatus != ReadIPConfigRecordStatus ||
+		    rightStatus != ReadIPConfigRecordStatus)
+		{
+			diff->removedCount += leftStatus == ReadIPConfigRecordStatus;
+			diff->addedCount += rightStatus == ReadIPConfigRecordStatus;
+			break;
+		}
+
+		if (!isSameIdentifier(leftSide, left, rightSide, right))
+		{
+			*finished = false;
+			break;
+		}
+
+		slotCount = getSlotCount(right->count);
+
+		if (!(slots = reserveArray(slots, &slotCapacity, slotCount,
+		                           sizeof *slots)))
+		{
+			compared = false;
+			break;
+		}
+
+		if (!compareRecords(diff, slots, leftSide, left, rightSide, right))
+		{
+			break;
+		}
+
+		clearSide(leftSide);
+		clearSide(rightSide);
+	}
+
+	free(slots);
+	return compared;
+}
+
+static bool haveSameContents(const char *left, const char *right)
+{
+	int descriptor = open(left, O_RDONLY);
+	struct stat status;
+	void *mapping = NULL;
+	bool same = false;
+
+	if (descriptor == -1)
+	{
+		return false;
+	}
+
+	if (fstat(descriptor, &status) == -1 || !S_ISREG(status.st_mode) ||
+	    !status.st_size)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE,
+	               descriptor, 0);
+	close(descriptor);
+
+	if (mapping == MAP_FAILED)
+	{
+		return false;
+	}
+
+	same = hasFileContents(right, mapping, status.st_size);
+	munmap(mapping, status.st_size);
+
+	return same;
+}
+
+/*
+ * Identical files are recognized by their bytes before anything is
+ * decoded.  Otherwise both sides are decoded, text at the version of a
+ * packed other side, and the older of two packed sides is transcoded to
+ * the newer version so that ids and gateways compare alike.  Without a
+ * stream the comparison stops at the first difference, usually without
+ * reading any further.
+ */
+
+bool diffIPConfigFiles(struct IPConfigDiff *diff, const char *left,
+                       const char *right, bool *equal)
+{
+	struct IPConfigDiffSide leftSide;
+	struct IPConfigDiffSide rightSide;
+	size_t *recordSlots = NULL;
+	size_t *attributeSlots = NULL;
+	uint32_t version = 0;
+	bool compared = false;
+	bool finished = false;
+
+	*equal = true;
+
+	if (haveSameContents(left, right))
+	{
+		return true;
+	}
+
+	memset(&leftSide, 0, sizeof leftSide);
+	memset(&rightSide, 0, sizeof rightSide);
+
+	if (openSide(&leftSide, left) && openSide(&rightSide, right))
+	{
+		version = leftSide.packed ? leftSide.reader.version : 0;
+
+		if (rightSide.packed && rightSide.reader.version > version)
+		{
+			version = rightSide.reader.version;
+		}
+
+		if (!version)
+		{
+			version = IPConfigDiffTextVersion;
+		}
+
+		compared = startSide(diff, &leftSide, version) &&
+		           startSide(diff, &rightSide, version);
+	}
+
+	if (compared && !diff->stream)
+	{
+		compared = compareInStep(diff, &leftSide, &rightSide, version,
+		                         &finished);
+	}
+
+	if (compared && !finished)
+	{
+		compared = loadSide(&leftSide, version) &&
+		           loadSide(&rightSide, version);
+	}
+
+	if (compared && !finished)
+	{
+		recordSlots = calloc(getSlotCount(rightSide.recordCount),
+		                     sizeof *recordSlots);
+		attributeSlots = calloc(getSlotCount(rightSide.largestRecord),
+		                        sizeof *attributeSlots);
+
+		if (!recordSlots || !attributeSlots)
+		{
+			printLibraryError("calloc");
+			compared = false;
+		}
+	}
+
+	if (compared && !finished)
+	{
+		compareSides(diff, &leftSide, &rightSide, recordSlots,
+		             attributeSlots);
+	}
+
+	if (compared)
+	{
+		*equal = !diff->addedCount && !diff->removedCount &&
+		         !diff->changedCount;
+	}
+
+	free(recordSlots);
+	free(attributeSlots);
+	deinitializeSide(&leftSide);
+	deinitializeSide(&rightSide);
+
+	return compared;
+}
+
+bool diffIPConfigRecords(struct IPConfigDiff *diff, struct IPConfig *left,
+                         struct IPConfig *right, size_t position)
+{
+	struct IPConfigDiffSide leftSide;
+	struct IPConfigDiffSide rightSide;
+	size_t *slots = NULL;
+	bool compared = false;
+
+	memset(&leftSide, 0, sizeof leftSide);
+	memset(&rightSide, 0, sizeof rightSide);
+
+	leftSide.config = *left;
+	rightSide.config = *right;
+	leftSide.position = position;
+	rightSide.position = position;
+
+	if (appendRecord(&leftSide) && appendRecord(&rightSide))
+	{
+		if (!(slots = calloc(getSlotCount(rightSide.largestRecord),
+		                     sizeof *slots)))
+		{
+			printLibraryError("calloc");
+		}
+
+		else
+		{
+			compareRecords(diff, slots, &leftSide, leftSide.records,
+			               &rightSide, rightSide.records);
+			compared = true;
+		}
+	}
+
+	free(slots);
+	releaseSide(&leftSide);
+	releaseSide(&rightSide);
+
+	return compared;
+}
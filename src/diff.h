@@ -0,0 +1,27 @@
+#ifndef IPCONFIG_DIFF_H
+#define IPCONFIG_DIFF_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ipconfig.h"
+
+struct IPConfigDiff
+{
+	FILE *stream;
+	enum IPConfigAddressMode addressMode;
+
+	size_t addedCount;
+	size_t removedCount;
+	size_t changedCount;
+};
+
+void initializeIPConfigDiff(struct IPConfigDiff *diff, FILE *stream);
+bool diffIPConfigFiles(struct IPConfigDiff *diff, const char *left,
+                       const char *right, bool *equal);
+bool diffIPConfigRecords(struct IPConfigDiff *diff, struct IPConfig *left,
+                         struct IPConfig *right, size_t position);
+
+#endif
@@ -0,0 +1,244 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "data.h"
+#include "edit.h"
+#include "ipconfig.h"
+#include "error.h"
+
+static bool isSameString(const struct IPConfigString *string,
+                         const char *data, size_t length)
+{
+	return string->length == length &&
+	       !memcmp(string->data, data, length);
+}
+
+static bool isIdentifier(enum IPConfigAttributeType type,
+                         const union IPConfigValue *value, const char *id)
+{
+	if (type == IntegerIPConfigAttributeType)
+	{
+		char *terminator = NULL;
+		unsigned long integer = strtoul(id, &terminator, 10);
+
+		return *id && !*terminator && integer == value->integer;
+	}
+
+	if (type == StringIPConfigAttributeType)
+	{
+		return isSameString(&value->string, id, strlen(id));
+	}
+
+	return false;
+}
+
+bool findPackedIPConfigAttribute(const void *data, size_t size,
+                                 const char *id, const char *key,
+                                 size_t occurrence,
+                                 struct IPConfigLocation *location)
+{
+	struct IPConfigInput input;
+	size_t keyLength = strlen(key);
+
+	initializeBufferIPConfigInput(&input, data, size);
+	memset(location, 0, sizeof *location);
+
+	if (!readPackedIPConfigHeader(&input, &location->version))
+	{
+		return false;
+	}
+
+	while (!isPackedInputFinished(&input))
+	{
+		size_t recordOffset = input.offset;
+		size_t count = 0;
+		bool identified = false;
+		bool found = false;
+
+		while (true)
+		{
+			struct IPConfigString name;
+			union IPConfigValue value;
+			enum IPConfigAttributeType type = InvalidIPConfigAttributeType;
+			size_t valueOffset = 0;
+
+			if (isPackedInputFinished(&input))
+			{
+				printError("missing record terminator");
+				return false;
+			}
+
+			if (!readPackedString(&input, &name))
+			{
+				printError("failed to read attribute key");
+				return false;
+			}
+
+			type = getIPConfigAttributeType(location->version, &name);
+
+			if (type == InvalidIPConfigAttributeType)
+			{
+				printError("unrecognized attribute key");
+				return false;
+			}
+
+			else if (type == TerminalIPConfigAttributeType)
+			{
+				break;
+			}
+
+			valueOffset = input.offset;
+
+			if (!readPackedValue(&input, type, &value))
+			{
+				printError("failed to read value");
+				return false;
+			}
+
+			if (isSameString(&name, IPConfigIdentifierKey.data,
+			                 IPConfigIdentifierKey.length))
+			{
+				identified = identified || isIdentifier(type, &value, id);
+			}
+
+			if (!found && isSameString(&name, key, keyLength) &&
+			    count++ == occurrence)
+			{
+				location->type = type;
+				location->valueOffset = valueOffset;
+				location->valueLength = input.offset - valueOffset;
+				found = true;
+			}
+		}
+
+		if (identified && found)
+		{
+			location->recordOffset = recordOffset;
+			location->recordLength = input.offset - recordOffset;
+
+			return true;
+		}
+	}
+
+	printError("attribute not found");
+	return false;
+}
+
+/*
+ * Let the kernel move the untouched ranges between the files, and fall
+ * back to writing them from the mapping where it cannot, such as when the
+ * output is a pipe or on another file system.
+ */
+
+static bool copyDescriptorRange(int input, int output,
+                                const unsigned char *data,
+                                size_t offset, size_t length)
+{
+	loff_t position = offset;
+
+	while (length)
+	{
+		ssize_t copied = copy_file_range(input, &position, output, NULL,
+		                                 length, 0);
+
+		if (copied <= 0)
+		{
+			return writeDescriptor(output, data + position, length);
+		}
+
+		length -= copied;
+	}
+
+	return true;
+}
+
+bool editPackedIPConfig(int input, int output,
+                        const struct IPConfigEdit *edit)
+{
+	struct IPConfigLocation location;
+	struct IPConfigArena arena = {0};
+	union IPConfigValue value;
+	struct stat status;
+
+	unsigned char *mapping = NULL;
+	unsigned char *buffer = NULL;
+	char *text = NULL;
+	size_t size = 0;
+	bool edited = false;
+
+	if (fstat(input, &status) == -1)
+	{
+		printLibraryError("fstat");
+		return false;
+	}
+
+	if (!S_ISREG(status.st_mode) || !status.st_size)
+	{
+		printError("input is not a regular packed file");
+		return false;
+	}
+
+	mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, input, 0);
+
+	if (mapping == MAP_FAILED)
+	{
+		printLibraryError("mmap");
+		return false;
+	}
+
+	if (!findPackedIPConfigAttribute(mapping, status.st_size, edit->id,
+	                                 edit->key, edit->occurrence, &location))
+	{
+		munmap(mapping, status.st_size);
+		return false;
+	}
+
+	memset(&value, 0, sizeof value);
+	text = strdup(edit->value);
+
+	if (!text)
+	{
+		printLibraryError("strdup");
+	}
+
+	else if (!parseUnpackedValue(text, &arena, location.type, &value))
+	{
+		printError("failed to parse value");
+	}
+
+	else if (!(buffer = malloc(measurePackedValue(location.type, &value))))
+	{
+		printLibraryError("malloc");
+	}
+
+	else
+	{
+		size = encodePackedValue(location.type, &value, buffer) - buffer;
+
+		edited = copyDescriptorRange(input, output, mapping, 0,
+		                             location.valueOffset) &&
+		         writeDescriptor(output, buffer, size) &&
+		         copyDescriptorRange(input, output, mapping,
+		                             location.valueOffset +
+		                             location.valueLength,
+		                             status.st_size -
+		                             location.valueOffset -
+		                             location.valueLength);
+	}
+
+	free(buffer);
+	free(text);
+	deinitializeIPConfigArena(&arena);
+	munmap(mapping, status.st_size);
+
+	return edited;
+}
@@ -0,0 +1,35 @@
+#ifndef IPCONFIG_EDIT_H
+#define IPCONFIG_EDIT_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "ipconfig.h"
+
+struct IPConfigEdit
+{
+	const char *id;
+	const char *key;
+	size_t occurrence;
+	const char *value;
+};
+
+struct IPConfigLocation
+{
+	uint32_t version;
+	enum IPConfigAttributeType type;
+	size_t recordOffset;
+	size_t recordLength;
+	size_t valueOffset;
+	size_t valueLength;
+};
+
+bool findPackedIPConfigAttribute(const void *data, size_t size,
+                                 const char *id, const char *key,
+                                 size_t occurrence,
+                                 struct IPConfigLocation *location);
+bool editPackedIPConfig(int input, int output,
+                        const struct IPConfigEdit *edit);
+
+#endif
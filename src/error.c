@@ -0,0 +1,63 @@
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "error.h"
+#include "ipconfig.h"
+#include "trace.h"
+
+/*
+ * Each thread keeps its own last error, so concurrent callers never see
+ * each other's failures.  Errors are only printed once a program has asked
+ * for them, which the command line tools do before starting any threads.
+ */
+
+static __thread struct IPConfigError IPConfigLastError;
+static FILE *IPConfigErrorStream = NULL;
+
+void reportIPConfigError(const char *function, int number,
+                         const char *format, ...)
+{
+	struct IPConfigError *error = &IPConfigLastError;
+	va_list arguments;
+
+	error->function = function;
+	error->number = number;
+
+	va_start(arguments, format);
+	vsnprintf(error->message, sizeof error->message, format, arguments);
+	va_end(arguments);
+
+	traceIPConfig3(error, function, number, error->message);
+
+	if (!IPConfigErrorStream)
+	{
+		return;
+	}
+
+	if (number)
+	{
+		fprintf(IPConfigErrorStream, "%s: %s: %s\n",
+		        function, error->message, strerror(number));
+	}
+
+	else
+	{
+		fprintf(IPConfigErrorStream, "%s: %s\n", function, error->message);
+	}
+}
+
+const struct IPConfigError *getIPConfigError(void)
+{
+	return &IPConfigLastError;
+}
+
+void clearIPConfigError(void)
+{
+	memset(&IPConfigLastError, 0, sizeof IPConfigLastError);
+}
+
+void setIPConfigErrorStream(FILE *stream)
+{
+	IPConfigErrorStream = stream;
+}
@@ -6,9 +6,12 @@
 #include <errno.h>
 
 #define printError(message) \
-	fprintf(stderr, "%s: %s\n", __func__, message)
+	reportIPConfigError(__func__, 0, "%s", message)
 
 #define printLibraryError(message) \
-	fprintf(stderr, "%s: %s: %s\n", __func__, message, strerror(errno))
+	reportIPConfigError(__func__, errno, "%s", message)
+
+void reportIPConfigError(const char *function, int number,
+                         const char *format, ...);
 
 #endif
@@ -0,0 +1,549 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "data.h"
+#include "index.h"
+#include "ipconfig.h"
+#include "error.h"
+
+static const unsigned char IPConfigIndexMagic[4] = {'I', 'P', 'C', 'X'};
+static const uint32_t IPConfigIndexFormat = 2;
+
+static const size_t IPConfigIndexMinimumCapacity = 16;
+
+static bool isSameIdentifier(enum IPConfigAttributeType type,
+                             const union IPConfigValue *left,
+                             const union IPConfigValue *right)
+{
+	if (type == IntegerIPConfigAttributeType)
+	{
+		return left->integer == right->integer;
+	}
+
+	return left->string.length == right->string.length &&
+	       !memcmp(left->string.data, right->string.data,
+	               left->string.length);
+}
+
+static struct IPConfigIndexEntry *appendEntry(struct IPConfigIndex *index)
+{
+	struct IPConfigIndexEntry *entry = NULL;
+
+	if (index->entryCount == index->entryCapacity)
+	{
+		size_t capacity = index->entryCapacity * 2;
+
+		if (capacity < IPConfigIndexMinimumCapacity)
+		{
+			capacity = IPConfigIndexMinimumCapacity;
+		}
+
+		entry = realloc(index->entries, capacity * sizeof *entry);
+
+		if (!entry)
+		{
+			printLibraryError("realloc");
+			return NULL;
+		}
+
+		index->entries = entry;
+		index->entryCapacity = capacity;
+	}
+
+	entry = &index->entries[index->entryCount++];
+	memset(entry, 0, sizeof *entry);
+	entry->idType = InvalidIPConfigAttributeType;
+
+	return entry;
+}
+
+/*
+ * Slots hold the entry index plus one in an open addressed table at most
+ * half full.  Only the first record carrying a given id is reachable,
+ * matching the order in which a sequential reader would meet them.
+ */
+
+static bool buildSlots(struct IPConfigIndex *index)
+{
+	size_t mask = 0;
+
+	index->slotCount = IPConfigIndexMinimumCapacity;
+
+	while (index->slotCount < index->entryCount * 2)
+	{
+		index->slotCount *= 2;
+	}
+
+	index->slots = calloc(index->slotCount, sizeof *index->slots);
+	mask = index->slotCount - 1;
+
+	if (!index->slots)
+	{
+		printLibraryError("calloc");
+		return false;
+	}
+
+	for (size_t position = 0; position < index->entryCount; position++)
+	{
+		struct IPConfigIndexEntry *entry = &index->entries[position];
+		size_t slot = 0;
+
+		if (entry->idType == InvalidIPConfigAttributeType)
+		{
+			continue;
+		}
+
+		slot = hashIPConfigValue(IPConfigHashBasis, entry->idType,
+		                         &entry->id) & mask;
+
+		while (index->slots[slot] &&
+		       !isSameIdentifier(entry->idType, &entry->id,
+		                         &index->entries[index->slots[slot] - 1].id))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		if (!index->slots[slot])
+		{
+			index->slots[slot] = position + 1;
+		}
+	}
+
+	return true;
+}
+
+static bool indexRecord(struct IPConfigIndex *index, struct IPConfig *config,
+                        size_t offset, size_t length)
+{
+	struct IPConfigIndexEntry *entry = appendEntry(index);
+
+	if (!entry)
+	{
+		return false;
+	}
+
+	entry->offset = offset;
+	entry->length = length;
+	entry->version = index->version;
+
+	for (size_t position = 0; position < config->attributeCount; position++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[position];
+		struct IPConfigString *string = &entry->id.string;
+
+		if (attribute->key.length != IPConfigIdentifierKey.length ||
+		    memcmp(attribute->key.data, IPConfigIdentifierKey.data,
+		           IPConfigIdentifierKey.length))
+		{
+			continue;
+		}
+
+		entry->idType = attribute->type;
+		entry->id = attribute->value;
+
+		if (attribute->type == StringIPConfigAttributeType)
+		{
+			string->data = duplicateIPConfigArenaString(&index->arena,
+			                                            string->data,
+			                                            string->length);
+
+			if (!string->data)
+			{
+				printLibraryError("malloc");
+				return false;
+			}
+		}
+
+		break;
+	}
+
+	return true;
+}
+
+bool buildIPConfigIndex(struct IPConfigIndex *index,
+                        const void *data, size_t size)
+{
+	struct IPConfigInput input;
+	struct IPConfig config = {0};
+	enum IPConfigRecordStatus status = EndIPConfigRecordStatus;
+
+	memset(index, 0, sizeof *index);
+	initializeBufferIPConfigInput(&input, data, size);
+	index->fileSize = size;
+
+	if (!readPackedIPConfigHeader(&input, &index->version))
+	{
+		return false;
+	}
+
+	config.version = index->version;
+
+	for (;;)
+	{
+		size_t offset = input.offset;
+
+		status = readPackedIPConfigRecord(&input, &config);
+
+		if (status != ReadIPConfigRecordStatus)
+		{
+			break;
+		}
+
+		if (!indexRecord(index, &config, offset, input.offset - offset))
+		{
+			status = FailedIPConfigRecordStatus;
+			break;
+		}
+
+		resetIPConfig(&config);
+	}
+
+	deinitializeIPConfig(&config);
+
+	if (status == FailedIPConfigRecordStatus || !buildSlots(index))
+	{
+		deinitializeIPConfigIndex(index);
+		return false;
+	}
+
+	return true;
+}
+
+static uint64_t getModificationTime(const struct stat *status)
+{
+	return (uint64_t) status->st_mtim.tv_sec * 1000000000 +
+	       status->st_mtim.tv_nsec;
+}
+
+bool buildIPConfigIndexFile(struct IPConfigIndex *index, FILE *stream)
+{
+	int descriptor = fileno(stream);
+	struct stat status;
+	void *mapping = NULL;
+	bool built = false;
+
+	if (descriptor == -1 || fstat(descriptor, &status) == -1 ||
+	    !S_ISREG(status.st_mode) || !status.st_size)
+	{
+		printError("input is not a regular packed file");
+		return false;
+	}
+
+	mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE,
+	               descriptor, 0);
+
+	if (mapping == MAP_FAILED)
+	{
+		printLibraryError("mmap");
+		return false;
+	}
+
+	madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+	built = buildIPConfigIndex(index, mapping, status.st_size);
+	munmap(mapping, status.st_size);
+
+	if (built)
+	{
+		index->fileInode = status.st_ino;
+		index->fileModified = getModificationTime(&status);
+	}
+
+	return built;
+}
+
+static unsigned char *encodeUInt64(uint64_t value, unsigned char *cursor)
+{
+	cursor = encodePackedUInt32(value >> 32, cursor);
+	return encodePackedUInt32(value & 0xffffffff, cursor);
+}
+
+static bool readUInt64(struct IPConfigInput *input, uint64_t *value)
+{
+	uint32_t high = 0;
+	uint32_t low = 0;
+
+	if (!readPackedUInt32(input, &high) || !readPackedUInt32(input, &low))
+	{
+		return false;
+	}
+
+	*value = (uint64_t) high << 32 | low;
+	return true;
+}
+
+bool writeIPConfigIndex(struct IPConfigIndex *index, FILE *stream)
+{
+	unsigned char header[sizeof IPConfigIndexMagic + 3 * sizeof(uint32_t) +
+	                     3 * sizeof(uint64_t)];
+	unsigned char *cursor = header;
+
+	memcpy(cursor, IPConfigIndexMagic, sizeof IPConfigIndexMagic);
+	cursor = encodePackedUInt32(IPConfigIndexFormat,
+	                            cursor + sizeof IPConfigIndexMagic);
+	cursor = encodePackedUInt32(index->version, cursor);
+	cursor = encodeUInt64(index->fileSize, cursor);
+	cursor = encodeUInt64(index->fileInode, cursor);
+	cursor = encodeUInt64(index->fileModified, cursor);
+	cursor = encodePackedUInt32(index->entryCount, cursor);
+
+	if (fwrite(header, sizeof header, 1, stream) != 1)
+	{
+		printError("failed to write index header");
+		return false;
+	}
+
+	for (size_t position = 0; position < index->entryCount; position++)
+	{
+		struct IPConfigIndexEntry *entry = &index->entries[position];
+		unsigned char buffer[5 * sizeof(uint32_t)];
+		const char *string = NULL;
+		size_t length = 0;
+
+		cursor = encodeUInt64(entry->offset, buffer);
+		cursor = encodePackedUInt32(entry->length, cursor);
+		cursor = encodePackedUInt32(entry->idType, cursor);
+
+		if (entry->idType == IntegerIPConfigAttributeType)
+		{
+			cursor = encodePackedUInt32(entry->id.integer, cursor);
+		}
+
+		else if (entry->idType == StringIPConfigAttributeType)
+		{
+			string = entry->id.string.data;
+			length = entry->id.string.length;
+			cursor = encodePackedUInt16(length, cursor);
+		}
+
+		if (fwrite(buffer, cursor - buffer, 1, stream) != 1 ||
+		    (length && fwrite(string, length, 1, stream) != 1))
+		{
+			printError("failed to write index entry");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool readEntry(struct IPConfigIndex *index, struct IPConfigInput *input,
+                      struct IPConfigIndexEntry *entry)
+{
+	uint32_t type = 0;
+
+	if (!readUInt64(input, &entry->offset) ||
+	    !readPackedUInt32(input, &entry->length) ||
+	    !readPackedUInt32(input, &type))
+	{
+		return false;
+	}
+
+	entry->idType = (int32_t) type;
+	entry->version = index->version;
+
+	if (entry->idType == IntegerIPConfigAttributeType)
+	{
+		return readPackedUInt32(input, &entry->id.integer);
+	}
+
+	else if (entry->idType == StringIPConfigAttributeType)
+	{
+		struct IPConfigString *string = &entry->id.string;
+		uint16_t length = 0;
+		char *data = NULL;
+
+		if (!readPackedUInt16(input, &length) ||
+		    !(data = allocateIPConfigArena(&index->arena, length + 1)))
+		{
+			return false;
+		}
+
+		if (length && fread(data, length, 1, input->stream) != 1)
+		{
+			return false;
+		}
+
+		string->data = data;
+		string->length = length;
+
+		return true;
+	}
+
+	return entry->idType == InvalidIPConfigAttributeType;
+}
+
+bool readIPConfigIndex(struct IPConfigIndex *index, FILE *stream)
+{
+	struct IPConfigInput input;
+	unsigned char magic[sizeof IPConfigIndexMagic];
+	uint32_t format = 0;
+	uint32_t count = 0;
+
+	memset(index, 0, sizeof *index);
+	initializeStreamIPConfigInput(&input, stream);
+
+	if (fread(magic, sizeof magic, 1, stream) != 1 ||
+	    memcmp(magic, IPConfigIndexMagic, sizeof magic) ||
+	    !readPackedUInt32(&input, &format) ||
+	    format != IPConfigIndexFormat)
+	{
+		printError("unrecognized index format");
+		return false;
+	}
+
+	if (!readPackedUInt32(&input, &index->version) ||
+	    !readUInt64(&input, &index->fileSize) ||
+	    !readUInt64(&input, &index->fileInode) ||
+	    !readUInt64(&input, &index->fileModified) ||
+	    !readPackedUInt32(&input, &count))
+	{
+		printError("failed to read index header");
+		return false;
+	}
+
+	for (uint32_t position = 0; position < count; position++)
+	{
+		struct IPConfigIndexEntry *entry = appendEntry(index);
+
+		if (!entry || !readEntry(index, &input, entry))
+		{
+			printError("failed to read index entry");
+			deinitializeIPConfigIndex(index);
+			return false;
+		}
+	}
+
+	if (!buildSlots(index))
+	{
+		deinitializeIPConfigIndex(index);
+		return false;
+	}
+
+	return true;
+}
+
+const struct IPConfigIndexEntry *findIPConfigIndexEntry(
+	const struct IPConfigIndex *index, const char *id)
+{
+	enum IPConfigAttributeType type = InvalidIPConfigAttributeType;
+	union IPConfigValue value;
+	size_t mask = index->slotCount - 1;
+	size_t slot = 0;
+
+	if (!index->slotCount)
+	{
+		return NULL;
+	}
+
+	type = getIPConfigAttributeType(index->version, &IPConfigIdentifierKey);
+
+	if (type == IntegerIPConfigAttributeType)
+	{
+		char *terminator = NULL;
+
+		value.integer = strtoul(id, &terminator, 10);
+
+		if (!*id || *terminator)
+		{
+			return NULL;
+		}
+	}
+
+	else
+	{
+		value.string.data = id;
+		value.string.length = strlen(id);
+	}
+
+	slot = hashIPConfigValue(IPConfigHashBasis, type, &value) & mask;
+
+	while (index->slots[slot])
+	{
+		const struct IPConfigIndexEntry *entry =
+			&index->entries[index->slots[slot] - 1];
+
+		if (entry->idType == type &&
+		    isSameIdentifier(type, &entry->id, &value))
+		{
+			return entry;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return NULL;
+}
+
+/*
+ * Offsets are only trusted for the very file that was indexed: the same
+ * size, inode and modification time.  Indexes built from a buffer have no
+ * file behind them and are checked by size alone.
+ */
+
+static bool isCurrentIndex(const struct IPConfigIndex *index,
+                           const struct stat *status)
+{
+	if ((uint64_t) status->st_size != index->fileSize)
+	{
+		return false;
+	}
+
+	return !index->fileInode ||
+	       (index->fileInode == (uint64_t) status->st_ino &&
+	        index->fileModified == getModificationTime(status));
+}
+
+enum IPConfigRecordStatus readIndexedIPConfigRecord(
+	const struct IPConfigIndex *index, FILE *stream,
+	const char *id, struct IPConfig *config)
+{
+	const struct IPConfigIndexEntry *entry = findIPConfigIndexEntry(index,
+	                                                                id);
+	struct IPConfigInput input;
+	struct stat status;
+
+	if (!entry)
+	{
+		printError("record not found");
+		return FailedIPConfigRecordStatus;
+	}
+
+	if (fstat(fileno(stream), &status) == -1 ||
+	    !isCurrentIndex(index, &status))
+	{
+		printError("index is out of date");
+		return FailedIPConfigRecordStatus;
+	}
+
+	if (fseeko(stream, entry->offset, SEEK_SET) == -1)
+	{
+		printLibraryError("fseeko");
+		return FailedIPConfigRecordStatus;
+	}
+
+	initializeStreamIPConfigInput(&input, stream);
+	config->version = entry->version;
+
+	return readPackedIPConfigRecord(&input, config);
+}
+
+void deinitializeIPConfigIndex(struct IPConfigIndex *index)
+{
+	free(index->entries);
+	free(index->slots);
+
+	index->entries = NULL;
+	index->entryCount = 0;
+	index->entryCapacity = 0;
+	index->slots = NULL;
+	index->slotCount = 0;
+
+	deinitializeIPConfigArena(&index->arena);
+}
@@ -0,0 +1,52 @@
+#ifndef IPCONFIG_INDEX_H
+#define IPCONFIG_INDEX_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "arena.h"
+#include "ipconfig.h"
+
+struct IPConfigIndexEntry
+{
+	enum IPConfigAttributeType idType;
+	union IPConfigValue id;
+	uint64_t offset;
+	uint32_t length;
+	uint32_t version;
+};
+
+struct IPConfigIndex
+{
+	uint32_t version;
+	uint64_t fileSize;
+	uint64_t fileInode;
+	uint64_t fileModified;
+
+	struct IPConfigIndexEntry *entries;
+	size_t entryCount;
+	size_t entryCapacity;
+
+	size_t *slots;
+	size_t slotCount;
+
+	struct IPConfigArena arena;
+};
+
+bool buildIPConfigIndex(struct IPConfigIndex *index,
+                        const void *data, size_t size);
+bool buildIPConfigIndexFile(struct IPConfigIndex *index, FILE *stream);
+bool readIPConfigIndex(struct IPConfigIndex *index, FILE *stream);
+bool writeIPConfigIndex(struct IPConfigIndex *index, FILE *stream);
+
+const struct IPConfigIndexEntry *findIPConfigIndexEntry(
+	const struct IPConfigIndex *index, const char *id);
+enum IPConfigRecordStatus readIndexedIPConfigRecord(
+	const struct IPConfigIndex *index, FILE *stream,
+	const char *id, struct IPConfig *config);
+
+void deinitializeIPConfigIndex(struct IPConfigIndex *index);
+
+#endif
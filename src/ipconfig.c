@@ -2,529 +2,2092 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "data.h"
 #include "ipconfig.h"
 #include "error.h"
+#include "schema.h"
+#include "stats.h"
+#include "trace.h"
+
+#define formatString(string) (int) (string).length, (string).data
+#define defineAttributeKey(key, type, address) \
+	{{key, sizeof key - 1}, type, address}
+#define defineSchemaType(type) type##IPConfigAttributeType
+#define defineSchemaKey(key, address, type) \
+	defineAttributeKey(#key, defineSchemaType(type), \
+	                   address##IPConfigAddressKind),
+#define defineSchemaVersion(version) \
+	{IPConfigAttributeSchema(defineSchemaKey, selectIPConfigVersion##version)},
+
+static const uint32_t IPConfigFileMinimumVersion = 1;
+static const uint32_t IPConfigFileMaximumVersion = IPConfigSchemaVersionCount;
+
+static struct IPConfigString IPConfigTerminatorKey = {"eos", 3};
+
+const struct IPConfigString IPConfigIdentifierKey = {"id", 2};
+
+static const struct IPConfigString IPConfigInternedValues[] =
+{
+	{"STATIC", 6},
+	{"DHCP", 4},
+	{"NONE", 4},
+	{"PAC", 3},
+	{"UNASSIGNED", 10}
+};
+
+static struct IPConfigAttributeKey IPConfigAttributeKeys
+	[IPConfigSchemaVersionCount][IPConfigSchemaKeyCount] =
+{
+	IPConfigSchemaVersions(defineSchemaVersion)
+};
+
+/*
+ * The schema lists the same keys in the same order for every version, so a
+ * single hash over (length + second to last character) selects the only
+ * candidate entry in any of the tables.  The slots, holding the table index
+ * plus one, are filled from the schema on first use; should two keys ever
+ * share a slot, lookups fall back to scanning the table.
+ */
+
+static unsigned char IPConfigAttributeKeySlots[32];
+static bool IPConfigAttributeKeysHashed = false;
+static pthread_once_t IPConfigAttributeKeySlotsOnce = PTHREAD_ONCE_INIT;
+
+static size_t hashAttributeKey(const struct IPConfigString *key)
+{
+	return (key->length + (unsigned char) key->data[key->length - 2]) & 31;
+}
+
+static void fillAttributeKeySlots(void)
+{
+	for (size_t index = 0; index < IPConfigSchemaKeyCount; index++)
+	{
+		struct IPConfigString *key = &IPConfigAttributeKeys[0][index].key;
+		size_t slot = 0;
+
+		if (key->length < 2)
+		{
+			return;
+		}
+
+		slot = hashAttributeKey(key);
+
+		if (IPConfigAttributeKeySlots[slot])
+		{
+			return;
+		}
+
+		IPConfigAttributeKeySlots[slot] = index + 1;
+	}
+
+	IPConfigAttributeKeysHashed = true;
+}
+
+static struct IPConfigAttributeKey *getAttributeKeys(uint32_t version)
+{
+	if (version < IPConfigFileMinimumVersion ||
+	    version > IPConfigFileMaximumVersion)
+	{
+		return NULL;
+	}
+
+	return IPConfigAttributeKeys[version - IPConfigFileMinimumVersion];
+}
+
+static bool isAttributeKey(const struct IPConfigAttributeKey *candidate,
+                           const struct IPConfigString *key)
+{
+	return candidate->key.length == key->length &&
+	       !memcmp(candidate->key.data, key->data, key->length);
+}
+
+static struct IPConfigAttributeKey *findAttributeKey(
+	struct IPConfigAttributeKey *keys, const struct IPConfigString *key)
+{
+	struct IPConfigAttributeKey *candidate = NULL;
+	size_t slot = 0;
+
+	pthread_once(&IPConfigAttributeKeySlotsOnce, fillAttributeKeySlots);
+
+	if (!IPConfigAttributeKeysHashed)
+	{
+		for (size_t index = 0; index < IPConfigSchemaKeyCount; index++)
+		{
+			if (isAttributeKey(&keys[index], key))
+			{
+				return &keys[index];
+			}
+		}
+
+		return NULL;
+	}
+
+	if (key->length < 2)
+	{
+		return NULL;
+	}
+
+	slot = IPConfigAttributeKeySlots[hashAttributeKey(key)];
+
+	if (!slot)
+	{
+		return NULL;
+	}
+
+	candidate = &keys[slot - 1];
+
+	if (!isAttributeKey(candidate, key))
+	{
+		return NULL;
+	}
+
+	return candidate;
+}
+
+static enum IPConfigAttributeType getAttributeType(
+	struct IPConfigAttributeKey *keys, const struct IPConfigString *key)
+{
+	struct IPConfigAttributeKey *candidate = findAttributeKey(keys, key);
+
+	if (!candidate)
+	{
+		return InvalidIPConfigAttributeType;
+	}
+
+	return candidate->type;
+}
+
+enum IPConfigAttributeType getIPConfigAttributeType(
+	uint32_t version, const struct IPConfigString *key)
+{
+	struct IPConfigAttributeKey *keys = getAttributeKeys(version);
+
+	if (!keys)
+	{
+		return InvalidIPConfigAttributeType;
+	}
+
+	return getAttributeType(keys, key);
+}
+
+bool getIPConfigLinkAddress(const struct IPConfigLink *link,
+                            struct IPConfigAddress *address)
+{
+	const struct IPConfigString *string = &link->address;
+
+	if (!string->data ||
+	    !parseIPConfigAddress(string->data, string->length, address) ||
+	    link->prefix > address->prefix)
+	{
+		return false;
+	}
+
+	address->prefix = link->prefix;
+	return true;
+}
+
+static bool checkAddress(struct IPConfig *config,
+                         enum IPConfigAddressMode mode,
+                         enum IPConfigAddressKind kind,
+                         struct IPConfigString *string,
+                         const uint32_t *prefix)
+{
+	struct IPConfigAddress address;
+	char buffer[IPConfigAddressStringLength];
+	size_t length = 0;
+
+	if (!string->data || !string->length)
+	{
+		return true;
+	}
+
+	if (!parseIPConfigAddress(string->data, string->length, &address))
+	{
+		return kind == HostIPConfigAddressKind &&
+		       isIPConfigHostName(string->data, string->length);
+	}
+
+	if (prefix && *prefix > address.prefix)
+	{
+		return false;
+	}
+
+	if (mode != CanonicalIPConfigAddressMode)
+	{
+		return true;
+	}
+
+	length = formatIPConfigAddress(&address, buffer);
+
+	if (length == string->length && !memcmp(buffer, string->data, length))
+	{
+		return true;
+	}
+
+	string->data = duplicateIPConfigArenaString(&config->arena,
+	                                            buffer, length);
+	string->length = length;
+
+	return string->data != NULL;
+}
+
+static bool checkAttributeAddresses(struct IPConfig *config,
+                                    enum IPConfigAddressMode mode,
+                                    enum IPConfigAddressKind kind,
+                                    struct IPConfigAttribute *attribute)
+{
+	union IPConfigValue *value = &attribute->value;
+	struct IPConfigLink *destination = &value->route.destination;
+
+	switch (attribute->type)
+	{
+		case StringIPConfigAttributeType:
+			return checkAddress(config, mode, kind, &value->string, NULL);
+
+		case LinkIPConfigAttributeType:
+			return checkAddress(config, mode, kind, &value->link.address,
+			                    &value->link.prefix);
+
+		case RouteIPConfigAttributeType:
+			return checkAddress(config, mode, kind, &destination->address,
+			                    &destination->prefix) &&
+			       checkAddress(config, mode, kind, &value->route.nextHop,
+			                    NULL);
+
+		default:
+			return true;
+	}
+}
+
+bool checkIPConfigAddresses(struct IPConfig *config,
+                            enum IPConfigAddressMode mode)
+{
+	struct IPConfigAttributeKey *keys = getAttributeKeys(config->version);
+
+	if (!keys)
+	{
+		printError("unrecognized file version");
+		return false;
+	}
+
+	if (mode == OpaqueIPConfigAddressMode)
+	{
+		return true;
+	}
+
+	for (size_t index = 0; index < config->attributeCount; index++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[index];
+		struct IPConfigAttributeKey *key = findAttributeKey(keys,
+		                                                    &attribute->key);
+
+		if (!key || !key->address)
+		{
+			continue;
+		}
+
+		if (!checkAttributeAddresses(config, mode, key->address, attribute))
+		{
+			reportIPConfigError(__func__, 0, "malformed address in %.*s",
+			                    formatString(attribute->key));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Keys always resolve to the static key tables, and the handful of values
+ * that recur in every record resolve to IPConfigInternedValues; anything
+ * else still read into the caller's scratch buffer is copied to the arena.
+ */
+
+static bool internValue(struct IPConfigArena *arena,
+                        struct IPConfigString *string, const char *scratch)
+{
+	size_t count = sizeof IPConfigInternedValues /
+	               sizeof *IPConfigInternedValues;
+
+	for (size_t index = 0; index < count; index++)
+	{
+		const struct IPConfigString *value = &IPConfigInternedValues[index];
+
+		if (value->length == string->length &&
+		    !memcmp(value->data, string->data, string->length))
+		{
+			*string = *value;
+			return true;
+		}
+	}
+
+	if (string->data == scratch)
+	{
+		string->data = duplicateIPConfigArenaString(arena, scratch,
+		                                            string->length);
+	}
+
+	return string->data != NULL;
+}
+
+static const size_t IPConfigMinimumAttributeCapacity = 16;
+
+struct IPConfigAttribute *appendIPConfigAttribute(struct IPConfig *config)
+{
+	struct IPConfigAttribute *attribute = NULL;
+
+	if (config->attributeCount == config->attributeCapacity)
+	{
+		size_t capacity = config->attributeCapacity * 2;
+
+		if (capacity < IPConfigMinimumAttributeCapacity)
+		{
+			capacity = IPConfigMinimumAttributeCapacity;
+		}
+
+		attribute = realloc(config->attributes,
+		                    capacity * sizeof *attribute);
+
+		if (!attribute)
+		{
+			printLibraryError("realloc");
+			return NULL;
+		}
+
+		countIPConfigAllocation(capacity * sizeof *attribute);
+		config->attributes = attribute;
+		config->attributeCapacity = capacity;
+	}
+
+	attribute = &config->attributes[config->attributeCount++];
+	memset(attribute, 0, sizeof *attribute);
+
+	return attribute;
+}
+
+void initializeStreamIPConfigInput(struct IPConfigInput *input, FILE *stream)
+{
+	input->stream = stream;
+	input->data = NULL;
+	input->size = 0;
+	input->offset = 0;
+	input->arena = NULL;
+}
+
+void initializeBufferIPConfigInput(struct IPConfigInput *input,
+                                   const void *data, size_t size)
+{
+	input->stream = NULL;
+	input->data = data;
+	input->size = size;
+	input->offset = 0;
+	input->arena = NULL;
+}
+
+bool readPackedIPConfigHeader(struct IPConfigInput *input, uint32_t *version)
+{
+	if (!readPackedUInt32(input, version))
+	{
+		printError("failed to read file version");
+		return false;
+	}
+	
+	if (*version < IPConfigFileMinimumVersion ||
+	    *version > IPConfigFileMaximumVersion)
+	{
+		printError("unrecognized file version");
+		return false;
+	}
+
+	countIPConfigBytesRead(sizeof *version);
+	return true;
+}
+
+/*
+ * The type comes from the schema entry for the key, so every value is read
+ * by a single switch rather than a comparison per type.
+ */
+
+static bool readAttributeValue(struct IPConfigInput *input,
+                               struct IPConfig *config,
+                               struct IPConfigAttribute *attribute,
+                               char *scratch)
+{
+	union IPConfigValue *value = &attribute->value;
+
+	switch (attribute->type)
+	{
+		case IntegerIPConfigAttributeType:
+			if (!readPackedUInt32(input, &value->integer))
+			{
+				printError("failed to read integer");
+				return false;
+			}
+
+			return true;
+
+		case StringIPConfigAttributeType:
+			if (!readPackedStringInto(input, scratch, IPConfigScratchCapacity,
+			                          &value->string) ||
+			    !internValue(&config->arena, &value->string, scratch))
+			{
+				printError("failed to read string");
+				return false;
+			}
+
+			return true;
+
+		case LinkIPConfigAttributeType:
+			if (!readPackedLink(input, &value->link))
+			{
+				printError("failed to read link");
+				return false;
+			}
+
+			return true;
+
+		case RouteIPConfigAttributeType:
+			if (!readPackedRoute(input, &value->route))
+			{
+				printError("failed to read route");
+				return false;
+			}
+
+			return true;
+
+		default:
+			return true;
+	}
+}
+
+enum IPConfigRecordStatus readPackedIPConfigRecord(struct IPConfigInput *input,
+                                                   struct IPConfig *config)
+{
+	struct IPConfigAttributeKey *keys = getAttributeKeys(config->version);
+	size_t offset = input->offset;
+
+	if (!keys)
+	{
+		printError("unrecognized file version");
+		return FailedIPConfigRecordStatus;
+	}
+
+	input->arena = &config->arena;
+
+	if (isPackedInputFinished(input))
+	{
+		return EndIPConfigRecordStatus;
+	}
+
+	traceIPConfig1(record__start, config->version);
+
+	while (true)
+	{
+		struct IPConfigAttribute *attribute = NULL;
+		struct IPConfigAttributeKey *key = NULL;
+		char scratch[IPConfigScratchCapacity];
+		size_t valueOffset = 0;
+
+		if (isPackedInputFinished(input))
+		{
+			printError("missing record terminator");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (!(attribute = appendIPConfigAttribute(config)))
+		{
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (!readPackedStringInto(input, scratch, sizeof scratch,
+		                          &attribute->key))
+		{
+			printError("failed to read attribute key");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		key = findAttributeKey(keys, &attribute->key);
+
+		if (!key)
+		{
+			printError("unrecognized attribute key");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		attribute->key = key->key;
+		attribute->type = key->type;
+		valueOffset = input->offset;
+		countIPConfigAttribute(attribute->type);
+
+		if (attribute->type == TerminalIPConfigAttributeType)
+		{
+			break;
+		}
+
+		if (!readAttributeValue(input, config, attribute, scratch))
+		{
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		traceIPConfig4(attribute__decode, attribute->key.data,
+		               attribute->key.length, attribute->type,
+		               input->offset - valueOffset);
+	}
+
+	traceIPConfig3(record__end, config->version, config->attributeCount,
+	               input->offset - offset);
+	countIPConfigRecord();
+	countIPConfigBytesRead(input->offset - offset);
+
+	return ReadIPConfigRecordStatus;
+}
+
+static bool readPackedIPConfigInput(struct IPConfigInput *input,
+                                    struct IPConfig *config)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		DecodeIPConfigStatsPhase);
+	bool read = readPackedIPConfigHeader(input, &config->version) &&
+	            readPackedIPConfigRecord(input, config) ==
+	            ReadIPConfigRecordStatus;
+
+	enterIPConfigStatsPhase(phase);
+
+	if (!read)
+	{
+		printError("failed to read record");
+		return false;
+	}
+
+	return true;
+}
+
+bool readPackedIPConfig(FILE *stream, struct IPConfig *config)
+{
+	struct IPConfigInput input;
+	initializeStreamIPConfigInput(&input, stream);
+
+	return readPackedIPConfigInput(&input, config);
+}
+
+bool readPackedIPConfigBuffer(const void *data, size_t size,
+                              struct IPConfig *config)
+{
+	struct IPConfigInput input;
+	initializeBufferIPConfigInput(&input, data, size);
+
+	return readPackedIPConfigInput(&input, config);
+}
+
+bool readPackedIPConfigDescriptor(int descriptor, struct IPConfig *config)
+{
+	size_t size = 0;
+	void *data = readDescriptor(descriptor, &size);
+	void *copy = NULL;
+
+	if (!data)
+	{
+		return false;
+	}
+
+	copy = allocateIPConfigArena(&config->arena, size);
+
+	if (!copy)
+	{
+		printLibraryError("malloc");
+		free(data);
+		return false;
+	}
+
+	memcpy(copy, data, size);
+	free(data);
+
+	return readPackedIPConfigBuffer(copy, size, config);
+}
+
+void resetIPConfig(struct IPConfig *config)
+{
+	config->attributeCount = 0;
+	resetIPConfigArena(&config->arena);
+}
+
+void deinitializeIPConfig(struct IPConfig *config)
+{
+	free(config->attributes);
+
+	config->attributes = NULL;
+	config->attributeCount = 0;
+	config->attributeCapacity = 0;
+
+	deinitializeIPConfigArena(&config->arena);
+}
+
+size_t measurePackedIPConfigRecord(struct IPConfig *config)
+{
+	bool terminated = false;
+	size_t size = 0;
+
+	for (size_t index = 0; index < config->attributeCount; index++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[index];
+		union IPConfigValue *value = &attribute->value;
+
+		size += measurePackedString(&attribute->key);
+
+		if (attribute->type == TerminalIPConfigAttributeType)
+		{
+			terminated = true;
+			break;
+		}
+
+		size += measurePackedValue(attribute->type, value);
+	}
+
+	if (!terminated)
+	{
+		size += measurePackedString(&IPConfigTerminatorKey);
+	}
+
+	return size;
+}
+
+size_t measurePackedIPConfig(struct IPConfig *config)
+{
+	return sizeof config->version + measurePackedIPConfigRecord(config);
+}
+
+size_t encodePackedIPConfigRecord(struct IPConfig *config, void *buffer)
+{
+	bool terminated = false;
+	unsigned char *cursor = buffer;
+
+	for (size_t index = 0; index < config->attributeCount; index++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[index];
+		union IPConfigValue *value = &attribute->value;
+
+		cursor = encodePackedString(&attribute->key, cursor);
+
+		if (attribute->type == TerminalIPConfigAttributeType)
+		{
+			terminated = true;
+			break;
+		}
+
+		cursor = encodePackedValue(attribute->type, value, cursor);
+	}
+
+	if (!terminated)
+	{
+		cursor = encodePackedString(&IPConfigTerminatorKey, cursor);
+	}
+
+	return cursor - (unsigned char *) buffer;
+}
+
+size_t encodePackedIPConfig(struct IPConfig *config, void *buffer)
+{
+	unsigned char *cursor = encodePackedUInt32(config->version, buffer);
+	return sizeof config->version + encodePackedIPConfigRecord(config, cursor);
+}
+
+void *encodePackedIPConfigBlob(struct IPConfig *config, size_t *size)
+{
+	size_t capacity = measurePackedIPConfig(config);
+	void *blob = malloc(capacity);
+
+	if (!blob)
+	{
+		printLibraryError("malloc");
+		return NULL;
+	}
+
+	countIPConfigAllocation(capacity);
+	*size = encodePackedIPConfig(config, blob);
+	return blob;
+}
+
+/*
+ * Packed and JSON output is encoded into the arena and then written in one
+ * piece, so that the time spent in each of the two is measured separately.
+ */
+
+static bool writeEncodedBuffer(const void *buffer, size_t size, FILE *stream)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		WriteIPConfigStatsPhase);
+	bool written = fwrite(buffer, size, 1, stream) == 1;
+
+	enterIPConfigStatsPhase(phase);
+
+	if (written)
+	{
+		countIPConfigBytesWritten(size);
+	}
+
+	return written;
+}
+
+bool writePackedIPConfigHeader(uint32_t version, FILE *stream)
+{
+	unsigned char buffer[sizeof version];
+	encodePackedUInt32(version, buffer);
+
+	if (!writeEncodedBuffer(buffer, sizeof buffer, stream))
+	{
+		printError("failed to write file version");
+		return false;
+	}
+
+	return true;
+}
+
+static void *encodePackedBuffer(struct IPConfig *config, bool header,
+                                size_t *size)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		EncodeIPConfigStatsPhase);
+	void *buffer = NULL;
+
+	*size = header ? measurePackedIPConfig(config)
+	               : measurePackedIPConfigRecord(config);
+
+	if ((buffer = allocateIPConfigArena(&config->arena, *size)))
+	{
+		if (header)
+		{
+			encodePackedIPConfig(config, buffer);
+		}
+
+		else
+		{
+			encodePackedIPConfigRecord(config, buffer);
+		}
+	}
+
+	enterIPConfigStatsPhase(phase);
+	return buffer;
+}
+
+bool writePackedIPConfigRecord(struct IPConfig *config, FILE *stream)
+{
+	size_t size = 0;
+	void *buffer = encodePackedBuffer(config, false, &size);
+
+	if (!buffer)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	if (!writeEncodedBuffer(buffer, size, stream))
+	{
+		printError("failed to write record");
+		return false;
+	}
+
+	return true;
+}
+
+bool writePackedIPConfig(struct IPConfig *config, FILE *stream)
+{
+	size_t size = 0;
+	void *buffer = encodePackedBuffer(config, true, &size);
+
+	if (!buffer)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	if (!writeEncodedBuffer(buffer, size, stream))
+	{
+		printError("failed to write config");
+		return false;
+	}
+
+	return true;
+}
+
+bool writePackedIPConfigDescriptor(struct IPConfig *config, int descriptor)
+{
+	size_t size = 0;
+	void *buffer = encodePackedBuffer(config, true, &size);
+
+	if (!buffer)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	if (!writeDescriptor(descriptor, buffer, size))
+	{
+		return false;
+	}
+
+	countIPConfigBytesWritten(size);
+	return true;
+}
+
+char *encodeUnpackedIPConfigBlob(struct IPConfig *config, size_t *size)
+{
+	char *blob = NULL;
+	FILE *stream = open_memstream(&blob, size);
+
+	if (!stream)
+	{
+		printLibraryError("open_memstream");
+		return NULL;
+	}
+
+	if (!writeUnpackedIPConfig(config, stream) || fclose(stream) == EOF)
+	{
+		printError("failed to write config");
+		free(blob);
+		return NULL;
+	}
+
+	return blob;
+}
+
+bool writeUnpackedIPConfigDescriptor(struct IPConfig *config, int descriptor)
+{
+	size_t size = 0;
+	char *blob = encodeUnpackedIPConfigBlob(config, &size);
+	bool written = false;
+
+	if (!blob)
+	{
+		return false;
+	}
+
+	written = writeDescriptor(descriptor, blob, size);
+	free(blob);
+
+	return written;
+}
+
+bool formatUnpackedIPConfigValue(struct IPConfigAttribute *attribute,
+                                 FILE *stream)
+{
+	int count = 0;
+
+	struct IPConfigLink *destination = &attribute->value.route.destination;
+	struct IPConfigString *nextHop = &attribute->value.route.nextHop;
+	struct IPConfigLink *link = &attribute->value.link;
+
+	switch (attribute->type)
+	{
+		case IntegerIPConfigAttributeType:
+			count = fprintf(stream, "%" PRIu32, attribute->value.integer);
+			break;
+
+		case StringIPConfigAttributeType:
+			count = fprintf(stream, "%.*s",
+			                formatString(attribute->value.string));
+			break;
+
+		case LinkIPConfigAttributeType:
+			count = fprintf(stream, "%.*s/%" PRIu32,
+			                formatString(link->address), link->prefix);
+			break;
+
+		case RouteIPConfigAttributeType:
+			if (destination->address.data && destination->prefix)
+			{
+				count = fprintf(stream, "%.*s/%" PRIu32 " %.*s",
+				                formatString(destination->address),
+				                destination->prefix,
+				                formatString(*nextHop));
+			}
+
+			else
+			{
+				count = fprintf(stream, "%.*s", formatString(*nextHop));
+			}
+
+			break;
+
+		default:
+			break;
+	}
+
+	if (count < 0)
+	{
+		return false;
+	}
+
+	countIPConfigBytesWritten(count);
+	return true;
+}
+
+bool writeUnpackedIPConfigValue(struct IPConfigAttribute *attribute,
+                                FILE *stream)
+{
+	if (!formatUnpackedIPConfigValue(attribute, stream) ||
+	    fputc('\n', stream) == EOF)
+	{
+		return false;
+	}
+
+	countIPConfigBytesWritten(1);
+	return true;
+}
+
+/*
+ * Text is formatted straight into the stream, so its flushes are measured
+ * as part of encoding rather than writing.
+ */
+
+bool writeUnpackedIPConfig(struct IPConfig *config, FILE *stream)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		EncodeIPConfigStatsPhase);
+	bool written = true;
+
+	for (size_t index = 0; written && index < config->attributeCount;
+	     index++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[index];
+		int count = 0;
+
+		if (attribute->type == InvalidIPConfigAttributeType ||
+		    attribute->type == TerminalIPConfigAttributeType)
+		{
+			continue;
+		}
+
+		count = fprintf(stream, "%.*s: ", formatString(attribute->key));
+		countIPConfigBytesWritten(count > 0 ? count : 0);
+
+		written = writeUnpackedIPConfigValue(attribute, stream);
+	}
+
+	enterIPConfigStatsPhase(phase);
+	return written;
+}
+
+static bool isSameKey(struct IPConfigAttribute *attribute,
+                      struct IPConfigAttribute *other)
+{
+	return attribute->key.length == other->key.length &&
+	       !memcmp(attribute->key.data, other->key.data,
+	               attribute->key.length);
+}
+
+static bool isJSONAttribute(struct IPConfigAttribute *attribute)
+{
+	return attribute->type != InvalidIPConfigAttributeType &&
+	       attribute->type != TerminalIPConfigAttributeType;
+}
+
+/*
+ * Attributes sharing a key are gathered under it, in the order the key
+ * first appears.  Links, routes and dns are always arrays so that their
+ * shape does not depend on how many a record holds; any other key only
+ * becomes an array if it does repeat.
+ */
+
+static bool isJSONArray(struct IPConfig *config, size_t first)
+{
+	struct IPConfigAttribute *attribute = &config->attributes[first];
+
+	if (attribute->type == LinkIPConfigAttributeType ||
+	    attribute->type == RouteIPConfigAttributeType ||
+	    (attribute->key.length == 3 &&
+	     !memcmp(attribute->key.data, "dns", 3)))
+	{
+		return true;
+	}
+
+	for (size_t index = first + 1; index < config->attributeCount; index++)
+	{
+		if (isJSONAttribute(&config->attributes[index]) &&
+		    isSameKey(attribute, &config->attributes[index]))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool isFirstJSONKey(struct IPConfig *config, size_t first)
+{
+	for (size_t index = 0; index < first; index++)
+	{
+		if (isJSONAttribute(&config->attributes[index]) &&
+		    isSameKey(&config->attributes[first], &config->attributes[index]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t boundJSONIPConfigRecord(struct IPConfig *config)
+{
+	size_t size = sizeof "{}\n";
+
+	for (size_t index = 0; index < config->attributeCount; index++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[index];
+
+		if (isJSONAttribute(attribute))
+		{
+			size += boundJSONString(&attribute->key) + sizeof ",:[]" +
+			        boundJSONValue(attribute->type, &attribute->value);
+		}
+	}
+
+	return size;
+}
+
+size_t encodeJSONIPConfigRecord(struct IPConfig *config, void *buffer)
+{
+	char *cursor = buffer;
+	bool firstKey = true;
+
+	*cursor++ = '{';
+
+	for (size_t first = 0; first < config->attributeCount; first++)
+	{
+		struct IPConfigAttribute *attribute = &config->attributes[first];
+		bool array = false;
+
+		if (!isJSONAttribute(attribute) || !isFirstJSONKey(config, first))
+		{
+			continue;
+		}
+
+		if (!firstKey)
+		{
+			*cursor++ = ',';
+		}
+
+		array = isJSONArray(config, first);
+		firstKey = false;
+		cursor = encodeJSONString(&attribute->key, cursor);
+		cursor = encodeJSONBytes(":[", array ? 2 : 1, cursor);
+
+		for (size_t index = first; index < config->attributeCount; index++)
+		{
+			struct IPConfigAttribute *value = &config->attributes[index];
+
+			if (!isJSONAttribute(value) || !isSameKey(attribute, value))
+			{
+				continue;
+			}
+
+			if (index != first)
+			{
+				*cursor++ = ',';
+			}
+
+			cursor = encodeJSONValue(value->type, &value->value, cursor);
+
+			if (!array)
+			{
+				break;
+			}
+		}
+
+		if (array)
+		{
+			*cursor++ = ']';
+		}
+	}
+
+	cursor = encodeJSONBytes("}\n", 2, cursor);
+	return cursor - (char *) buffer;
+}
+
+bool writeJSONIPConfigRecord(struct IPConfig *config, FILE *stream)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		EncodeIPConfigStatsPhase);
+	size_t size = 0;
+	void *buffer = allocateIPConfigArena(&config->arena,
+	                                     boundJSONIPConfigRecord(config));
+
+	if (buffer)
+	{
+		size = encodeJSONIPConfigRecord(config, buffer);
+	}
+
+	enterIPConfigStatsPhase(phase);
+
+	if (!buffer)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	if (!writeEncodedBuffer(buffer, size, stream))
+	{
+		printError("failed to write record");
+		return false;
+	}
+
+	return true;
+}
+
+static bool internKey(struct IPConfigAttributeKey *keys,
+                      struct IPConfigArena *arena,
+                      struct IPConfigString *string)
+{
+	struct IPConfigAttributeKey *key = findAttributeKey(keys, string);
+
+	if (key)
+	{
+		*string = key->key;
+		return true;
+	}
+
+	string->data = duplicateIPConfigArenaString(arena, string->data,
+	                                            string->length);
+
+	return string->data != NULL;
+}
+
+static bool appendTerminator(struct IPConfig *config)
+{
+	struct IPConfigAttribute *attribute = appendIPConfigAttribute(config);
+
+	if (!attribute)
+	{
+		return false;
+	}
+
+	attribute->type = TerminalIPConfigAttributeType;
+	attribute->key = IPConfigTerminatorKey;
+
+	return true;
+}
+
+static const size_t IPConfigScannerCapacity = 65536;
+
+bool initializeIPConfigScanner(struct IPConfigScanner *scanner,
+                               FILE *stream)
+{
+	scanner->stream = stream;
+	scanner->capacity = IPConfigScannerCapacity;
+	scanner->start = 0;
+	scanner->end = 0;
+	scanner->finished = false;
+	scanner->failed = false;
+	scanner->buffer = malloc(scanner->capacity);
+
+	if (!scanner->buffer)
+	{
+		printLibraryError("malloc");
+		return false;
+	}
+
+	countIPConfigAllocation(scanner->capacity);
+	return true;
+}
+
+void deinitializeIPConfigScanner(struct IPConfigScanner *scanner)
+{
+	free(scanner->buffer);
+
+	scanner->buffer = NULL;
+	scanner->capacity = 0;
+}
+
+static bool parseAttributeValue(struct IPConfig *config,
+                                struct IPConfigAttribute *attribute,
+                                char *text)
+{
+	union IPConfigValue *value = &attribute->value;
+
+	switch (attribute->type)
+	{
+		case IntegerIPConfigAttributeType:
+			if (!parseUnpackedUInt32(text, &value->integer))
+			{
+				printError("failed to read integer");
+				return false;
+			}
+
+			return true;
+
+		case StringIPConfigAttributeType:
+			value->string.data = text;
+			value->string.length = strlen(text);
+
+			if (!internValue(&config->arena, &value->string, text))
+			{
+				printLibraryError("malloc");
+				return false;
+			}
+
+			return true;
+
+		case LinkIPConfigAttributeType:
+			if (!parseUnpackedLink(text, &config->arena, &value->link))
+			{
+				printError("failed to read link");
+				return false;
+			}
+
+			return true;
+
+		case RouteIPConfigAttributeType:
+			if (!parseUnpackedRoute(text, &config->arena, &value->route))
+			{
+				printError("failed to read route");
+				return false;
+			}
+
+			return true;
+
+		default:
+			return true;
+	}
+}
+
+enum IPConfigRecordStatus readUnpackedIPConfigRecord(
+	struct IPConfigScanner *scanner, struct IPConfig *config)
+{
+	struct IPConfigAttributeKey *keys = getAttributeKeys(config->version);
+
+	if (!keys)
+	{
+		printError("unrecognized file version");
+		return FailedIPConfigRecordStatus;
+	}
+
+	while (!isUnpackedInputFinished(scanner))
+	{
+		char *line = NULL;
+		size_t length = 0;
+
+		char *key = NULL;
+		char *value = NULL;
+
+		struct IPConfigAttribute *attribute = NULL;
+
+		if (!readUnpackedLine(scanner, &line, &length))
+		{
+			printError("failed to read line");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+	
+		if (length == 0)
+		{
+			if (!config->attributeCount)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		if (!parseUnpackedPair(line, &key, &value))
+		{
+			printError("failed to read pair");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (!config->attributeCount)
+		{
+			traceIPConfig1(record__start, config->version);
+		}
+
+		attribute = appendIPConfigAttribute(config);
+
+		if (!attribute)
+		{
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		attribute->key.data = key;
+		attribute->key.length = strlen(key);
+		attribute->type = getAttributeType(keys, &attribute->key);
+
+		if (attribute->type <= TerminalIPConfigAttributeType)
+		{
+			printError("unrecognized attribute key");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (!internKey(keys, &config->arena, &attribute->key))
+		{
+			printLibraryError("malloc");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		countIPConfigAttribute(attribute->type);
+
+		if (!parseAttributeValue(config, attribute, value))
+		{
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		traceIPConfig4(attribute__decode, attribute->key.data,
+		               attribute->key.length, attribute->type,
+		               line + length - value);
+	}
+
+	if (scanner->failed)
+	{
+		printError("failed to read line");
+		deinitializeIPConfig(config);
+		return FailedIPConfigRecordStatus;
+	}
+
+	if (!config->attributeCount)
+	{
+		return EndIPConfigRecordStatus;
+	}
+
+	if (!appendTerminator(config))
+	{
+		deinitializeIPConfig(config);
+		return FailedIPConfigRecordStatus;
+	}
+
+	traceIPConfig3(record__end, config->version, config->attributeCount, 0);
+	countIPConfigRecord();
+	return ReadIPConfigRecordStatus;
+}
+
+static bool readJSONAttribute(char **cursor, struct IPConfig *config,
+                              struct IPConfigAttributeKey *key)
+{
+	struct IPConfigAttribute *attribute = appendIPConfigAttribute(config);
+	union IPConfigValue *value = NULL;
+
+	if (!attribute)
+	{
+		return false;
+	}
+
+	attribute->key = key->key;
+	attribute->type = key->type;
+	value = &attribute->value;
+	countIPConfigAttribute(attribute->type);
+
+	switch (attribute->type)
+	{
+		case IntegerIPConfigAttributeType:
+			if (!parseJSONUInt32(cursor, &value->integer))
+			{
+				printError("failed to read integer");
+				return false;
+			}
+
+			return true;
+
+		case StringIPConfigAttributeType:
+			if (!parseJSONString(cursor, &value->string))
+			{
+				printError("failed to read string");
+				return false;
+			}
+
+			if (!internValue(&config->arena, &value->string,
+			                 value->string.data))
+			{
+				printLibraryError("malloc");
+				return false;
+			}
+
+			return true;
+
+		case LinkIPConfigAttributeType:
+			if (!parseJSONLink(cursor, &config->arena, &value->link))
+			{
+				printError("failed to read link");
+				return false;
+			}
+
+			return true;
+
+		case RouteIPConfigAttributeType:
+			if (!parseJSONRoute(cursor, &config->arena, &value->route))
+			{
+				printError("failed to read route");
+				return false;
+			}
+
+			return true;
+
+		default:
+			return true;
+	}
+}
+
+static bool readJSONObject(char *cursor, struct IPConfigAttributeKey *keys,
+                           struct IPConfig *config)
+{
+	bool first = true;
+
+	if (!parseJSONCharacter(&cursor, '{'))
+	{
+		printError("failed to read object");
+		return false;
+	}
+
+	while (!parseJSONCharacter(&cursor, '}'))
+	{
+		struct IPConfigString name;
+		struct IPConfigAttributeKey *key = NULL;
+		bool array = false;
+
+		if ((!first && !parseJSONCharacter(&cursor, ',')) ||
+		    !parseJSONString(&cursor, &name) ||
+		    !parseJSONCharacter(&cursor, ':'))
+		{
+			printError("failed to read object");
+			return false;
+		}
+
+		first = false;
+		key = findAttributeKey(keys, &name);
+
+		if (!key || key->type == TerminalIPConfigAttributeType)
+		{
+			printError("unrecognized attribute key");
+			return false;
+		}
+
+		if ((array = parseJSONCharacter(&cursor, '[')) &&
+		    parseJSONCharacter(&cursor, ']'))
+		{
+			continue;
+		}
+
+		do
+		{
+			if (!readJSONAttribute(&cursor, config, key))
+			{
+				return false;
+			}
+		}
+		while (array && parseJSONCharacter(&cursor, ','));
+
+		if (array && !parseJSONCharacter(&cursor, ']'))
+		{
+			printError("failed to read array");
+			return false;
+		}
+	}
+
+	skipJSONSpace(&cursor);
+
+	if (*cursor)
+	{
+		printError("unexpected data after object");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Each non-blank line holds one record as a JSON object.  Strings are
+ * unescaped in the scanner's buffer, and copied out of it like text.
+ */
+
+enum IPConfigRecordStatus readJSONIPConfigRecord(
+	struct IPConfigScanner *scanner, struct IPConfig *config)
+{
+	struct IPConfigAttributeKey *keys = getAttributeKeys(config->version);
+	char *line = NULL;
+	size_t length = 0;
+
+	if (!keys)
+	{
+		printError("unrecognized file version");
+		return FailedIPConfigRecordStatus;
+	}
+
+	do
+	{
+		if (isUnpackedInputFinished(scanner))
+		{
+			if (scanner->failed)
+			{
+				printError("failed to read line");
+				return FailedIPConfigRecordStatus;
+			}
+
+			return EndIPConfigRecordStatus;
+		}
+
+		if (!readUnpackedLine(scanner, &line, &length))
+		{
+			printError("failed to read line");
+			return FailedIPConfigRecordStatus;
+		}
+
+		skipJSONSpace(&line);
+	}
+	while (!*line);
+
+	if (!readJSONObject(line, keys, config) || !appendTerminator(config))
+	{
+		deinitializeIPConfig(config);
+		return FailedIPConfigRecordStatus;
+	}
+
+	countIPConfigRecord();
+	return ReadIPConfigRecordStatus;
+}
+
+bool readUnpackedIPConfig(FILE *stream, struct IPConfig *config)
+{
+	struct IPConfigScanner scanner;
+	enum IPConfigRecordStatus status = FailedIPConfigRecordStatus;
+	enum IPConfigStatsPhase phase = NoIPConfigStatsPhase;
+
+	if (!initializeIPConfigScanner(&scanner, stream))
+	{
+		return false;
+	}
+
+	phase = enterIPConfigStatsPhase(DecodeIPConfigStatsPhase);
+	status = readUnpackedIPConfigRecord(&scanner, config);
+	enterIPConfigStatsPhase(phase);
+	deinitializeIPConfigScanner(&scanner);
+
+	if (status != ReadIPConfigRecordStatus)
+	{
+		printError("failed to read record");
+		return false;
+	}
+
+	return true;
+}
+
+bool readUnpackedIPConfigBuffer(const void *data, size_t size,
+                                struct IPConfig *config)
+{
+	FILE *stream = NULL;
+	bool read = false;
+
+	if (!size)
+	{
+		printError("failed to read record");
+		return false;
+	}
+
+	stream = fmemopen((void *) data, size, "r");
+
+	if (!stream)
+	{
+		printLibraryError("fmemopen");
+		return false;
+	}
 
-#define calculateElementCount(array) (sizeof array / sizeof *array)
+	read = readUnpackedIPConfig(stream, config);
+	fclose(stream);
 
-static const uint32_t IPConfigFileMinimumVersion = 1;
-static const uint32_t IPConfigFileMaximumVersion = 3;
-
-static char *IPConfigTerminatorKey = "eos";
-
-static struct IPConfigAttributeKey IPConfigVersion1AttributeKeys[] =
-{
-	{"id", IntegerIPConfigAttributeType},
-	{"ipAssignment", StringIPConfigAttributeType},
-	{"linkAddress", LinkIPConfigAttributeType},
-	{"gateway", StringIPConfigAttributeType},
-	{"dns", StringIPConfigAttributeType},
-	{"proxySettings", StringIPConfigAttributeType},
-	{"proxyHost", StringIPConfigAttributeType},
-	{"proxyPort", IntegerIPConfigAttributeType},
-	{"proxyPac", StringIPConfigAttributeType},
-	{"exclusionList", StringIPConfigAttributeType},
-	{"eos", TerminalIPConfigAttributeType}
-};
+	return read;
+}
 
-static size_t IPConfigVersion1AttributeKeyCount = 
-	calculateElementCount(IPConfigVersion1AttributeKeys);
-
-static struct IPConfigAttributeKey IPConfigVersion2AttributeKeys[] =
-{
-	{"id", IntegerIPConfigAttributeType},
-	{"ipAssignment", StringIPConfigAttributeType},
-	{"linkAddress", LinkIPConfigAttributeType},
-	{"gateway", RouteIPConfigAttributeType},
-	{"dns", StringIPConfigAttributeType},
-	{"proxySettings", StringIPConfigAttributeType},
-	{"proxyHost", StringIPConfigAttributeType},
-	{"proxyPort", IntegerIPConfigAttributeType},
-	{"proxyPac", StringIPConfigAttributeType},
-	{"exclusionList", StringIPConfigAttributeType},
-	{"eos", TerminalIPConfigAttributeType}
-};
+bool readUnpackedIPConfigDescriptor(int descriptor, struct IPConfig *config)
+{
+	size_t size = 0;
+	void *data = readDescriptor(descriptor, &size);
+	bool read = false;
 
-static size_t IPConfigVersion2AttributeKeyCount = 
-	calculateElementCount(IPConfigVersion2AttributeKeys);
-
-static struct IPConfigAttributeKey IPConfigVersion3AttributeKeys[] =
-{
-	{"id", StringIPConfigAttributeType},
-	{"ipAssignment", StringIPConfigAttributeType},
-	{"linkAddress", LinkIPConfigAttributeType},
-	{"gateway", RouteIPConfigAttributeType},
-	{"dns", StringIPConfigAttributeType},
-	{"proxySettings", StringIPConfigAttributeType},
-	{"proxyHost", StringIPConfigAttributeType},
-	{"proxyPort", IntegerIPConfigAttributeType},
-	{"proxyPac", StringIPConfigAttributeType},
-	{"exclusionList", StringIPConfigAttributeType},
-	{"eos", TerminalIPConfigAttributeType}
-};
+	if (!data)
+	{
+		return false;
+	}
 
-static size_t IPConfigVersion3AttributeKeyCount = 
-	calculateElementCount(IPConfigVersion3AttributeKeys);
+	read = readUnpackedIPConfigBuffer(data, size, config);
+	free(data);
 
-static enum IPConfigAttributeType getAttributeType(uint32_t version, char *key)
+	return read;
+}
+
+bool initializePackedIPConfigReader(struct IPConfigReader *reader,
+                                    FILE *stream)
 {
-	size_t keyLength = strlen(key);
+	memset(reader, 0, sizeof *reader);
+	initializeStreamIPConfigInput(&reader->input, stream);
+	reader->packed = true;
 
-	struct IPConfigAttributeKey *keys = NULL;
-	size_t count = 0;
+	return readPackedIPConfigHeader(&reader->input, &reader->version);
+}
 
-	switch (version)
-	{
-		case 1:
-			keys = IPConfigVersion1AttributeKeys;
-			count = IPConfigVersion1AttributeKeyCount;
-			break;
+bool initializeBufferIPConfigReader(struct IPConfigReader *reader,
+                                    const void *data, size_t size)
+{
+	memset(reader, 0, sizeof *reader);
+	initializeBufferIPConfigInput(&reader->input, data, size);
+	reader->packed = true;
 
-		case 2:
-			keys = IPConfigVersion2AttributeKeys;
-			count = IPConfigVersion2AttributeKeyCount;
-			break;
+	return readPackedIPConfigHeader(&reader->input, &reader->version);
+}
 
-		case 3:
-			keys = IPConfigVersion3AttributeKeys;
-			count = IPConfigVersion3AttributeKeyCount;
-			break;
+bool initializeMappedIPConfigReader(struct IPConfigReader *reader,
+                                    FILE *stream)
+{
+	int descriptor = fileno(stream);
+	struct stat status;
+	off_t offset = ftello(stream);
+	void *mapping = NULL;
+	enum IPConfigStatsPhase phase = NoIPConfigStatsPhase;
+
+	if (descriptor == -1 || offset == -1 ||
+	    fstat(descriptor, &status) == -1 ||
+	    !S_ISREG(status.st_mode) || status.st_size <= offset)
+	{
+		return initializePackedIPConfigReader(reader, stream);
+	}
 
-		default:
-			break;
-	};
+	phase = enterIPConfigStatsPhase(ReadIPConfigStatsPhase);
+	mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE,
+	               descriptor, 0);
+	enterIPConfigStatsPhase(phase);
 
-	for (size_t index = 0; index < count; index++)
+	if (mapping == MAP_FAILED)
 	{
-		char *candidate = keys[index].key;
-		size_t maximumLength = strlen(candidate);
+		return initializePackedIPConfigReader(reader, stream);
+	}
 
-		if (keyLength > maximumLength)
-		{
-			maximumLength = keyLength;
-		}
+	madvise(mapping, status.st_size, MADV_SEQUENTIAL);
 
-		if (!strncmp(candidate, key, maximumLength))
-		{
-			return keys[index].type;
-		}
+	if (!initializeBufferIPConfigReader(reader,
+	                                    (char *) mapping + offset,
+	                                    status.st_size - offset))
+	{
+		munmap(mapping, status.st_size);
+		return false;
 	}
 
-	return InvalidIPConfigAttributeType;
+	reader->mapping = mapping;
+	reader->mappingSize = status.st_size;
+
+	return true;
 }
 
-static void appendAttribute(struct IPConfigAttribute *attribute,
-                            struct IPConfig *config)
+bool initializeUnpackedIPConfigReader(struct IPConfigReader *reader,
+                                      FILE *stream, uint32_t version)
 {
-	if (!config->attributes)
+	memset(reader, 0, sizeof *reader);
+	initializeStreamIPConfigInput(&reader->input, stream);
+	reader->packed = false;
+	reader->version = version;
+
+	if (version < IPConfigFileMinimumVersion ||
+	    version > IPConfigFileMaximumVersion)
 	{
-		config->attributes = attribute;
+		printError("unrecognized file version");
+		return false;
 	}
 
-	else
+	return initializeIPConfigScanner(&reader->scanner, stream);
+}
+
+bool initializeJSONIPConfigReader(struct IPConfigReader *reader,
+                                  FILE *stream, uint32_t version)
+{
+	if (!initializeUnpackedIPConfigReader(reader, stream, version))
 	{
-		struct IPConfigAttribute *previous = config->attributes;
+		return false;
+	}
 
-		while (previous->next)
-		{
-			previous = previous->next;
-		}
+	reader->json = true;
+	return true;
+}
+
+void deinitializeIPConfigReader(struct IPConfigReader *reader)
+{
+	deinitializeIPConfigScanner(&reader->scanner);
 
-		previous->next = attribute;
+	if (reader->mapping)
+	{
+		munmap(reader->mapping, reader->mappingSize);
 	}
+
+	reader->mapping = NULL;
+	reader->mappingSize = 0;
 }
 
-bool readPackedIPConfig(FILE *stream, struct IPConfig *config)
+enum IPConfigRecordStatus readIPConfigRecord(struct IPConfigReader *reader,
+                                             struct IPConfig *config)
 {
-	if (!readPackedUInt32(stream, &config->version))
+	enum IPConfigRecordStatus status = FailedIPConfigRecordStatus;
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		DecodeIPConfigStatsPhase);
+
+	config->version = reader->version;
+
+	if (reader->packed)
 	{
-		printError("failed to read file version");
-		return NULL;
+		status = readPackedIPConfigRecord(&reader->input, config);
 	}
-	
-	if (config->version < IPConfigFileMinimumVersion ||
-	    config->version > IPConfigFileMaximumVersion)
+
+	else if (reader->json)
 	{
-		printError("unrecognized file version");
-		return NULL;
+		status = readJSONIPConfigRecord(&reader->scanner, config);
 	}
 
-	while (!feof(stream))
+	else
 	{
-		struct IPConfigAttribute *attribute = NULL;
-		attribute = calloc(1, sizeof(struct IPConfigAttribute));
-
-		if (!attribute)
-		{
-			printLibraryError("calloc");
-			deinitializeIPConfig(config);
-			return NULL;
-		}
+		status = readUnpackedIPConfigRecord(&reader->scanner, config);
+	}
 
-		appendAttribute(attribute, config);
+	enterIPConfigStatsPhase(phase);
 
-		if (!readPackedString(stream, &attribute->key))
-		{
-			printError("failed to read attribute key");
-			deinitializeIPConfig(config);
-			return NULL;
-		}
+	if (status == ReadIPConfigRecordStatus &&
+	    !checkIPConfigAddresses(config, reader->addressMode))
+	{
+		deinitializeIPConfig(config);
+		return FailedIPConfigRecordStatus;
+	}
 
-		attribute->type = getAttributeType(config->version,
-		                                   attribute->key);
+	return status;
+}
 
-		if (attribute->type == InvalidIPConfigAttributeType)
-		{
-			printError("unrecognized attribute key");
-			deinitializeIPConfig(config);
-			return NULL;
-		}
+/*
+ * Only id and gateway change type between versions: id is an integer until
+ * version 3, and gateway is a bare address in version 1 where later versions
+ * hold a route.  A route with a destination, or an id that is not a number,
+ * has no equivalent in the older form.
+ */
+
+static bool transcodeAttribute(struct IPConfig *config,
+                               struct IPConfigAttribute *attribute,
+                               enum IPConfigAttributeType type,
+                               bool *represented)
+{
+	union IPConfigValue *value = &attribute->value;
 
-		else if (attribute->type == TerminalIPConfigAttributeType)
-		{
-			break;
-		}
+	*represented = true;
 
-		else if (attribute->type == IntegerIPConfigAttributeType)
-		{
-			uint32_t *integer = &attribute->value.integer;
+	if (attribute->type == IntegerIPConfigAttributeType &&
+	    type == StringIPConfigAttributeType)
+	{
+		char buffer[sizeof "4294967295"];
+		size_t length = snprintf(buffer, sizeof buffer, "%" PRIu32,
+		                         value->integer);
 
-			if (!readPackedUInt32(stream, integer))
-			{
-				printError("failed to read integer");
-				deinitializeIPConfig(config);
-				return NULL;
-			}
-		}
+		value->string.data = duplicateIPConfigArenaString(&config->arena,
+		                                                  buffer, length);
+		value->string.length = length;
 
-		else if (attribute->type == StringIPConfigAttributeType)
-		{
-			char **string = &attribute->value.string;
+		return value->string.data != NULL;
+	}
 
-			if (!readPackedString(stream, string))
-			{
-				printError("failed to read string");
-				deinitializeIPConfig(config);
-				return NULL;
-			}
-		}
+	else if (attribute->type == StringIPConfigAttributeType &&
+	         type == IntegerIPConfigAttributeType)
+	{
+		char buffer[sizeof "4294967295"];
+		char *terminator = NULL;
+		unsigned long integer = 0;
 
-		else if (attribute->type == LinkIPConfigAttributeType)
+		if (!value->string.length || value->string.length >= sizeof buffer)
 		{
-			if (!readPackedLink(stream, &attribute->value.link))
-			{
-				printError("failed to read link");
-				deinitializeIPConfig(config);
-				return NULL;
-			}
+			*represented = false;
+			return true;
 		}
 
-		else if (attribute->type == RouteIPConfigAttributeType)
-		{
-			if (!readPackedRoute(stream, &attribute->value.route))
-			{
-				printError("failed to read route");
-				deinitializeIPConfig(config);
-				return NULL;
-			}
-		}
-	}
+		memcpy(buffer, value->string.data, value->string.length);
+		buffer[value->string.length] = 0;
+		integer = strtoul(buffer, &terminator, 10);
 
-	return config;
-}
+		*represented = !*terminator && *buffer != '-' &&
+		               integer <= UINT32_MAX;
+		value->integer = integer;
 
-void deinitializeIPConfig(struct IPConfig *config)
-{
-	struct IPConfigAttribute *next = NULL;
-	struct IPConfigAttribute *attribute = config->attributes;
+		return true;
+	}
 
-	while (attribute)
+	else if (attribute->type == StringIPConfigAttributeType &&
+	         type == RouteIPConfigAttributeType)
 	{
-		union IPConfigValue *value = &attribute->value;
+		struct IPConfigString nextHop = value->string;
 
-		if (attribute->type == StringIPConfigAttributeType)
-		{
-			free(value->string);
-		}
+		memset(value, 0, sizeof *value);
+		value->route.nextHop = nextHop;
 
-		else if (attribute->type == LinkIPConfigAttributeType)
-		{
-			free(value->link.address);
-		}
+		return true;
+	}
 
-		else if (attribute->type == RouteIPConfigAttributeType)
-		{
-			if (value->route.destination.address)
-			{
-				free(value->route.destination.address);
-			}
+	else if (attribute->type == RouteIPConfigAttributeType &&
+	         type == StringIPConfigAttributeType)
+	{
+		struct IPConfigRoute route = value->route;
 
-			if (value->route.nextHop)
-			{
-				free(value->route.nextHop);
-			}
-		}
+		*represented = route.nextHop.data &&
+		               !(route.destination.address.data &&
+		                 route.destination.prefix);
+		value->string = route.nextHop;
 
-		next = attribute->next;	
-		free(attribute->key);
-		free(attribute);
-		attribute = next;
+		return true;
 	}
+
+	*represented = false;
+	return true;
 }
 
-bool writePackedIPConfig(struct IPConfig *config, FILE *stream)
+bool transcodeIPConfig(struct IPConfig *config, uint32_t version,
+                       size_t *droppedCount)
 {
-	bool terminated = false;
-	struct IPConfigAttribute *attribute = config->attributes;
+	struct IPConfigAttributeKey *keys = getAttributeKeys(version);
+	size_t keptCount = 0;
 
-	if (!writePackedUInt32(config->version, stream))
+	if (!keys)
 	{
-		printError("failed to write file version");
+		printError("unrecognized file version");
 		return false;
 	}
 
-	while (attribute)
+	for (size_t index = 0; index < config->attributeCount; index++)
 	{
-		union IPConfigValue *value = &attribute->value;
-
-		if (!writePackedString(attribute->key, stream))
+		struct IPConfigAttribute attribute = config->attributes[index];
+		struct IPConfigAttributeKey *key = findAttributeKey(keys,
+		                                                    &attribute.key);
+		bool represented = true;
+
+		if (key && key->type != attribute.type &&
+		    attribute.type != InvalidIPConfigAttributeType &&
+		    !transcodeAttribute(config, &attribute, key->type,
+		                        &represented))
 		{
-			printError("failed to write key");
+			printLibraryError("malloc");
 			return false;
 		}
 
-		if (attribute->type == TerminalIPConfigAttributeType)
+		if (!key || !represented)
 		{
-			terminated = true;
-			break;
-		}
+			reportIPConfigError(__func__, 0, "%.*s cannot be represented "
+			                    "in version %" PRIu32,
+			                    formatString(attribute.key), version);
 
-		else if (attribute->type == IntegerIPConfigAttributeType)
-		{
-			if (!writePackedUInt32(value->integer, stream))
-			{
-				printError("failed to write integer");
-				return false;
-			}
+			++*droppedCount;
+			continue;
 		}
 
-		else if (attribute->type == StringIPConfigAttributeType)
-		{
-			if (!writePackedString(value->string, stream))
-			{
-				printError("failed to write string");
-				return false;
-			}
-		}
+		attribute.key = key->key;
+		attribute.type = key->type;
+		config->attributes[keptCount++] = attribute;
+	}
 
-		else if (attribute->type == LinkIPConfigAttributeType)
-		{
-			if (!writePackedLink(&value->link, stream))
-			{
-				printError("failed to write link");
-				return false;
-			}
-		}
+	config->attributeCount = keptCount;
+	config->version = version;
 
-		else if (attribute->type == RouteIPConfigAttributeType)
-		{
-			if (!writePackedRoute(&value->route, stream))
-			{
-				printError("failed to write route");
-				return false;
-			}
-		}
+	return true;
+}
 
-		attribute = attribute->next;
-	}
+/*
+ * Attributes are put in the order Android writes them, which is the order
+ * of the key tables with the id moved last, keeping repeated keys such as
+ * dns in their original order.  Explicit terminators are dropped so that
+ * exactly one is written.
+ */
 
-	if (!terminated)
+static size_t getAttributeRank(struct IPConfigAttributeKey *keys,
+                               struct IPConfigString *key)
+{
+	static const size_t keyCount = IPConfigSchemaKeyCount;
+	struct IPConfigAttributeKey *candidate = findAttributeKey(keys, key);
+
+	if (!candidate)
 	{
-		if (!writePackedString(IPConfigTerminatorKey, stream))
-		{
-			printError("failed to write terminator");
-			return false;
-		}
+		return keyCount + 1;
 	}
 
-	return true;
+	return candidate == keys ? keyCount : (size_t) (candidate - keys);
 }
 
-bool writeUnpackedIPConfig(struct IPConfig *config, FILE *stream)
+bool canonicalizeIPConfig(struct IPConfig *config)
 {
-	struct IPConfigAttribute *attribute = config->attributes;
+	struct IPConfigAttributeKey *keys = getAttributeKeys(config->version);
+	size_t keptCount = 0;
 
-	while (attribute)
+	if (!keys)
 	{
-		if (attribute->type == IntegerIPConfigAttributeType)
-		{
-			fprintf(stream, "%s: %" PRIu32 "\n",
-			                attribute->key,
-			                attribute->value.integer);
-		}
+		printError("unrecognized file version");
+		return false;
+	}
 
-		else if (attribute->type == StringIPConfigAttributeType)
-		{
-			fprintf(stream, "%s: %s\n",
-			                attribute->key,
-			                attribute->value.string);
-		}
+	for (size_t index = 0; index < config->attributeCount; index++)
+	{
+		struct IPConfigAttribute attribute = config->attributes[index];
+		size_t rank = getAttributeRank(keys, &attribute.key);
+		size_t position = keptCount;
 
-		else if (attribute->type == LinkIPConfigAttributeType)
+		if (attribute.type == TerminalIPConfigAttributeType)
 		{
-			struct IPConfigLink *link = &attribute->value.link;
-
-			fprintf(stream, "%s: %s/%" PRIu32 "\n",
-			                attribute->key,
-			                link->address,
-			                link->prefix);
+			continue;
 		}
 
-		else if (attribute->type == RouteIPConfigAttributeType)
+		while (position &&
+		       getAttributeRank(keys,
+		                        &config->attributes[position - 1].key) > rank)
 		{
-			struct IPConfigRoute *route = &attribute->value.route;
-			struct IPConfigLink *destination = &route->destination;
-
-			if (destination->address && destination->prefix)
-			{
-				fprintf(stream, "%s: %s/%" PRIu32 " %s\n",
-			                        attribute->key,
-			                        destination->address,
-			                        destination->prefix,
-			                        route->nextHop);
-			}
-
-			else
-			{
-				fprintf(stream, "%s: %s\n",
-			                        attribute->key,
-			                        route->nextHop);
-			}
+			config->attributes[position] = config->attributes[position - 1];
+			position--;
 		}
 
-		attribute = attribute->next;
+		config->attributes[position] = attribute;
+		keptCount++;
 	}
 
+	config->attributeCount = keptCount;
 	return true;
 }
 
-bool readUnpackedIPConfig(FILE *stream, struct IPConfig *config)
+bool initializePackedIPConfigWriter(struct IPConfigWriter *writer,
+                                    FILE *stream, uint32_t version)
 {
-	if (config->version < IPConfigFileMinimumVersion ||
-	    config->version > IPConfigFileMaximumVersion)
-	{
-		printError("unrecognized file version");
-		return false;
-	}
+	writer->stream = stream;
+	writer->packed = true;
+	writer->json = false;
+	writer->canonical = false;
+	writer->version = version;
+	writer->recordCount = 0;
+	writer->droppedCount = 0;
+
+	return writePackedIPConfigHeader(version, stream);
+}
 
-	while (!feof(stream))
-	{
-		char *line = NULL;
-		char *value = NULL;
+void initializeUnpackedIPConfigWriter(struct IPConfigWriter *writer,
+                                      FILE *stream)
+{
+	writer->stream = stream;
+	writer->packed = false;
+	writer->json = false;
+	writer->canonical = false;
+	writer->version = 0;
+	writer->recordCount = 0;
+	writer->droppedCount = 0;
+}
 
-		struct IPConfigAttribute *attribute = NULL;
-		attribute = calloc(1, sizeof(struct IPConfigAttribute));
+void initializeJSONIPConfigWriter(struct IPConfigWriter *writer,
+                                  FILE *stream)
+{
+	initializeUnpackedIPConfigWriter(writer, stream);
+	writer->json = true;
+}
 
-		if (!attribute)
+static bool writeRecord(struct IPConfigWriter *writer,
+                        struct IPConfig *config)
+{
+	if (writer->packed)
+	{
+		if (config->version != writer->version &&
+		    !transcodeIPConfig(config, writer->version,
+		                       &writer->droppedCount))
 		{
-			printLibraryError("calloc");
-			deinitializeIPConfig(config);
 			return false;
 		}
 
-		appendAttribute(attribute, config);
-
-		if (!readUnpackedLine(stream, &line))
+		if (writer->canonical && !canonicalizeIPConfig(config))
 		{
-			printError("failed to read line");
-			deinitializeIPConfig(config);
 			return false;
 		}
-	
-		if (strlen(line) == 0)
-		{
-			free(line);
-
-			if (feof(stream))
-			{
-				attribute->key = strdup(IPConfigTerminatorKey);
-				break;
-			}
 
-			continue;
+		if (!writePackedIPConfigRecord(config, writer->stream))
+		{
+			return false;
 		}
+	}
 
-		if (!parseUnpackedPair(line, &attribute->key, &value))
+	else if (writer->json)
+	{
+		if (writer->canonical && !canonicalizeIPConfig(config))
 		{
-			printError("failed to read pair");
-			deinitializeIPConfig(config);
-			free(line);
 			return false;
 		}
 
-		free(line);
-		attribute->type = getAttributeType(config->version,
-		                                   attribute->key);
-
-		if (!attribute->type)
+		if (!writeJSONIPConfigRecord(config, writer->stream))
 		{
-			printError("unrecognized attribute type");
-			deinitializeIPConfig(config);
-			free(value);
 			return false;
 		}
+	}
 
-		else if (attribute->type == IntegerIPConfigAttributeType)
+	else
+	{
+		if (writer->canonical && !canonicalizeIPConfig(config))
 		{
-			uint32_t *integer = &attribute->value.integer;
+			return false;
+		}
 
-			if (!parseUnpackedUInt32(value, integer))
+		if (writer->recordCount)
+		{
+			if (fputc('\n', writer->stream) == EOF)
 			{
-				printError("failed to read integer");
-				deinitializeIPConfig(config);
-				free(value);
+				printLibraryError("fputc");
 				return false;
 			}
 
-			free(value);
+			countIPConfigBytesWritten(1);
 		}
 
-		else if (attribute->type == StringIPConfigAttributeType)
+		if (!writeUnpackedIPConfig(config, writer->stream))
 		{
-			attribute->value.string = value;
+			return false;
 		}
+	}
 
-		else if (attribute->type == LinkIPConfigAttributeType)
-		{
-			if (!parseUnpackedLink(value, &attribute->value.link))
-			{
-				printError("failed to read link");
-				deinitializeIPConfig(config);
-				free(value);
-				return false;
-			}
+	writer->recordCount++;
+	return true;
+}
 
-			free(value);
-		}
+bool writeIPConfigRecord(struct IPConfigWriter *writer,
+                         struct IPConfig *config)
+{
+	enum IPConfigStatsPhase phase = enterIPConfigStatsPhase(
+		EncodeIPConfigStatsPhase);
+	bool written = false;
 
-		else if (attribute->type == RouteIPConfigAttributeType)
-		{
-			struct IPConfigRoute *route = &attribute->value.route;
+	traceIPConfig2(encode__start, config->version, config->attributeCount);
+	written = writeRecord(writer, config);
+	traceIPConfig2(encode__end, writer->version, written);
 
-			if (!parseUnpackedRoute(value, route))
-			{
-				printError("failed to read route");
-				deinitializeIPConfig(config);
-				free(value);
-				return false;
-			}
+	enterIPConfigStatsPhase(phase);
+	return written;
+}
+
+bool convertIPConfig(struct IPConfigReader *reader,
+                     struct IPConfigWriter *writer,
+                     struct IPConfig *config)
+{
+	enum IPConfigRecordStatus status = EndIPConfigRecordStatus;
+
+	while ((status = readIPConfigRecord(reader, config)) ==
+	       ReadIPConfigRecordStatus)
+	{
+		bool written = writeIPConfigRecord(writer, config);
+		resetIPConfig(config);
 
-			free(value);
+		if (!written)
+		{
+			return false;
 		}
 	}
 
-	return true;
+	resetIPConfig(config);
+	return status == EndIPConfigRecordStatus;
 }
@@ -3,6 +3,11 @@
 
 #include <stdbool.h>
 #include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "address.h"
+#include "arena.h"
 
 enum IPConfigAttributeType
 {
@@ -14,28 +19,49 @@ enum IPConfigAttributeType
 	RouteIPConfigAttributeType = 4
 };
 
+enum IPConfigAddressKind
+{
+	NoIPConfigAddressKind = 0,
+	AddressIPConfigAddressKind = 1,
+	HostIPConfigAddressKind = 2
+};
+
+enum IPConfigAddressMode
+{
+	OpaqueIPConfigAddressMode = 0,
+	ValidatedIPConfigAddressMode = 1,
+	CanonicalIPConfigAddressMode = 2
+};
+
+struct IPConfigString
+{
+	const char *data;
+	size_t length;
+};
+
 struct IPConfigAttributeKey
 {
-	char *key;
+	struct IPConfigString key;
 	enum IPConfigAttributeType type;
+	enum IPConfigAddressKind address;
 };
 
 struct IPConfigLink
 {
-	char *address;
+	struct IPConfigString address;
 	uint32_t prefix;
 };
 
 struct IPConfigRoute
 {
 	struct IPConfigLink destination;
-	char *nextHop;
+	struct IPConfigString nextHop;
 };
 
 union IPConfigValue
 {
 	uint32_t integer;
-	char *string;
+	struct IPConfigString string;
 	struct IPConfigLink link;
 	struct IPConfigRoute route;
 };
@@ -43,22 +69,172 @@ union IPConfigValue
 struct IPConfigAttribute
 {
 	enum IPConfigAttributeType type;
-	char *key;
+	struct IPConfigString key;
 	union IPConfigValue value;
-	struct IPConfigAttribute *next;
 };
 
 struct IPConfig
 {
 	uint32_t version;
 	struct IPConfigAttribute *attributes;
+	size_t attributeCount;
+	size_t attributeCapacity;
+	struct IPConfigArena arena;
+};
+
+enum IPConfigRecordStatus
+{
+	FailedIPConfigRecordStatus = -1,
+	EndIPConfigRecordStatus = 0,
+	ReadIPConfigRecordStatus = 1
+};
+
+struct IPConfigInput
+{
+	FILE *stream;
+	const unsigned char *data;
+	size_t size;
+	size_t offset;
+	struct IPConfigArena *arena;
 };
 
+struct IPConfigScanner
+{
+	FILE *stream;
+	char *buffer;
+	size_t capacity;
+	size_t start;
+	size_t end;
+	bool finished;
+	bool failed;
+};
+
+struct IPConfigReader
+{
+	struct IPConfigInput input;
+	struct IPConfigScanner scanner;
+	void *mapping;
+	size_t mappingSize;
+	uint32_t version;
+	bool packed;
+	bool json;
+	enum IPConfigAddressMode addressMode;
+};
+
+struct IPConfigError
+{
+	const char *function;
+	int number;
+	char message[256];
+};
+
+struct IPConfigWriter
+{
+	FILE *stream;
+	uint32_t version;
+	bool packed;
+	bool json;
+	bool canonical;
+	size_t recordCount;
+	size_t droppedCount;
+};
+
+/*
+ * The key every record is identified by, shared by all schema versions.
+ */
+
+extern const struct IPConfigString IPConfigIdentifierKey;
+
+void initializeStreamIPConfigInput(struct IPConfigInput *input, FILE *stream);
+void initializeBufferIPConfigInput(struct IPConfigInput *input,
+                                   const void *data, size_t size);
+
+bool readPackedIPConfigHeader(struct IPConfigInput *input, uint32_t *version);
+enum IPConfigRecordStatus readPackedIPConfigRecord(struct IPConfigInput *input,
+                                                   struct IPConfig *config);
+bool initializeIPConfigScanner(struct IPConfigScanner *scanner,
+                               FILE *stream);
+void deinitializeIPConfigScanner(struct IPConfigScanner *scanner);
+
+enum IPConfigRecordStatus readUnpackedIPConfigRecord(
+	struct IPConfigScanner *scanner, struct IPConfig *config);
+enum IPConfigRecordStatus readJSONIPConfigRecord(
+	struct IPConfigScanner *scanner, struct IPConfig *config);
+size_t measurePackedIPConfigRecord(struct IPConfig *config);
+size_t measurePackedIPConfig(struct IPConfig *config);
+size_t encodePackedIPConfigRecord(struct IPConfig *config, void *buffer);
+size_t encodePackedIPConfig(struct IPConfig *config, void *buffer);
+void *encodePackedIPConfigBlob(struct IPConfig *config, size_t *size);
+
+bool writePackedIPConfigHeader(uint32_t version, FILE *stream);
+bool writePackedIPConfigRecord(struct IPConfig *config, FILE *stream);
+
+size_t boundJSONIPConfigRecord(struct IPConfig *config);
+size_t encodeJSONIPConfigRecord(struct IPConfig *config, void *buffer);
+bool writeJSONIPConfigRecord(struct IPConfig *config, FILE *stream);
+
+bool initializePackedIPConfigReader(struct IPConfigReader *reader,
+                                    FILE *stream);
+bool initializeBufferIPConfigReader(struct IPConfigReader *reader,
+                                    const void *data, size_t size);
+bool initializeMappedIPConfigReader(struct IPConfigReader *reader,
+                                    FILE *stream);
+bool initializeUnpackedIPConfigReader(struct IPConfigReader *reader,
+                                      FILE *stream, uint32_t version);
+bool initializeJSONIPConfigReader(struct IPConfigReader *reader,
+                                  FILE *stream, uint32_t version);
+void deinitializeIPConfigReader(struct IPConfigReader *reader);
+enum IPConfigRecordStatus readIPConfigRecord(struct IPConfigReader *reader,
+                                             struct IPConfig *config);
+
+bool initializePackedIPConfigWriter(struct IPConfigWriter *writer,
+                                    FILE *stream, uint32_t version);
+void initializeUnpackedIPConfigWriter(struct IPConfigWriter *writer,
+                                      FILE *stream);
+void initializeJSONIPConfigWriter(struct IPConfigWriter *writer,
+                                  FILE *stream);
+bool writeIPConfigRecord(struct IPConfigWriter *writer,
+                         struct IPConfig *config);
+
+bool canonicalizeIPConfig(struct IPConfig *config);
+bool transcodeIPConfig(struct IPConfig *config, uint32_t version,
+                       size_t *droppedCount);
+bool convertIPConfig(struct IPConfigReader *reader,
+                     struct IPConfigWriter *writer,
+                     struct IPConfig *config);
+
 bool readPackedIPConfig(FILE *stream, struct IPConfig *config);
+bool readPackedIPConfigBuffer(const void *data, size_t size,
+                              struct IPConfig *config);
+bool readPackedIPConfigDescriptor(int descriptor, struct IPConfig *config);
 bool readUnpackedIPConfig(FILE *stream, struct IPConfig *config);
+bool readUnpackedIPConfigBuffer(const void *data, size_t size,
+                                struct IPConfig *config);
+bool readUnpackedIPConfigDescriptor(int descriptor, struct IPConfig *config);
 bool writePackedIPConfig(struct IPConfig *config, FILE *stream);
+bool writePackedIPConfigDescriptor(struct IPConfig *config, int descriptor);
 bool writeUnpackedIPConfig(struct IPConfig *config, FILE *stream);
+bool writeUnpackedIPConfigDescriptor(struct IPConfig *config, int descriptor);
+char *encodeUnpackedIPConfigBlob(struct IPConfig *config, size_t *size);
+bool formatUnpackedIPConfigValue(struct IPConfigAttribute *attribute,
+                                 FILE *stream);
+bool writeUnpackedIPConfigValue(struct IPConfigAttribute *attribute,
+                                FILE *stream);
+
+enum IPConfigAttributeType getIPConfigAttributeType(
+	uint32_t version, const struct IPConfigString *key);
+
+bool getIPConfigLinkAddress(const struct IPConfigLink *link,
+                            struct IPConfigAddress *address);
+bool checkIPConfigAddresses(struct IPConfig *config,
+                            enum IPConfigAddressMode mode);
+
+const struct IPConfigError *getIPConfigError(void);
+void clearIPConfigError(void);
+void setIPConfigErrorStream(FILE *stream);
 
+struct IPConfigAttribute *appendIPConfigAttribute(struct IPConfig *config);
+void resetIPConfig(struct IPConfig *config);
 void deinitializeIPConfig(struct IPConfig *config);
 
 #endif
@@ -1,71 +1,737 @@
-#define _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
 
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "data.h"
+#include "diff.h"
+#include "edit.h"
+#include "index.h"
+#include "query.h"
+#include "server.h"
+#include "stats.h"
+#include "verify.h"
+#include "watch.h"
 #include "ipconfig.h"
 #include "error.h"
 
+#define IPConfigStatsOption 256
+
 static void usage(FILE *stream)
 {
-	fprintf(stream, "usage: ipconfigstore OPTION\n");
+	fprintf(stream, "usage: ipconfigstore OPTION [-o DIRECTORY "
+	                "[-m MANIFEST] [-j THREADS] [FILE|DIRECTORY]...]\n");
+	fprintf(stream, "       ipconfigstore -e ID KEY[:INDEX] VALUE\n");
+	fprintf(stream, "       ipconfigstore -x INDEX [-r ID]\n");
+	fprintf(stream, "       ipconfigstore -q [KEY=VALUE]... [key=KEY]\n");
+	fprintf(stream, "       ipconfigstore -S SOCKET [-j THREADS]\n");
+	fprintf(stream, "       ipconfigstore -d [-s] FILE FILE\n");
+	fprintf(stream, "       ipconfigstore -W FILE\n");
+	fprintf(stream, "       ipconfigstore -v [FILE|DIRECTORY]...\n");
 	fprintf(stream, "\n");
 	fprintf(stream, "Options:\n");
 	fprintf(stream, "  -p VERSION    Pack IP configuration\n");
 	fprintf(stream, "  -u            Unpack IP configuration\n");
+	fprintf(stream, "  -t VERSION    Transcode packed configuration to VERSION\n");
+	fprintf(stream, "  -c            Validate and canonicalize addresses\n");
+	fprintf(stream, "  -J            Read or write text as NDJSON\n");
+	fprintf(stream, "  -w FILE       Write canonical output to FILE if changed\n");
+	fprintf(stream, "  -e            Edit one attribute of a packed file\n");
+	fprintf(stream, "  -x INDEX      Write an index of a packed file to INDEX\n");
+	fprintf(stream, "  -r ID         Unpack the record ID found through INDEX\n");
+	fprintf(stream, "  -q            Print values from matching records\n");
+	fprintf(stream, "  -S SOCKET     Serve requests on a Unix socket\n");
+	fprintf(stream, "  -d            Compare two configurations\n");
+	fprintf(stream, "  -s            Only report whether they differ\n");
+	fprintf(stream, "  -W FILE       Watch a packed FILE and report changes\n");
+	fprintf(stream, "  -v            Verify packed files without decoding them\n");
+	fprintf(stream, "\n");
+	fprintf(stream, "Batch options:\n");
+	fprintf(stream, "  -o DIRECTORY  Convert files into DIRECTORY\n");
+	fprintf(stream, "  -m MANIFEST   Read input paths from MANIFEST\n");
+	fprintf(stream, "  -j THREADS    Number of worker threads\n");
 	fprintf(stream, "\n");
+	fprintf(stream, "Conversion options:\n");
+	fprintf(stream, "  --stats       Print conversion statistics as JSON\n");
+	fprintf(stream, "\n");
+}
+
+static int runBatch(int mode, uint32_t version,
+                    enum IPConfigAddressMode addressMode,
+                    const char *outputDirectory,
+                    const char *manifest, long threadCount,
+                    bool json, bool collectStats,
+                    int pathCount, char *paths[])
+{
+	struct IPConfigBatch batch;
+	bool succeeded = true;
+
+	initializeIPConfigBatch(&batch, outputDirectory, mode == 'p', version);
+	batch.transcode = mode == 't';
+	batch.json = json;
+	batch.addressMode = addressMode;
+	batch.collectStats = collectStats;
+
+	if (threadCount > 0)
+	{
+		batch.threadCount = threadCount;
+	}
+
+	if (manifest && !addIPConfigBatchManifest(&batch, manifest))
+	{
+		deinitializeIPConfigBatch(&batch);
+		return EXIT_FAILURE;
+	}
+
+	for (int index = 0; index < pathCount; index++)
+	{
+		if (!addIPConfigBatchPath(&batch, paths[index]))
+		{
+			deinitializeIPConfigBatch(&batch);
+			return EXIT_FAILURE;
+		}
+	}
+
+	succeeded = runIPConfigBatch(&batch);
+
+	printf("files: %zu, converted: %zu, failed: %zu, records: %zu",
+	       batch.pathCount, batch.convertedCount,
+	       batch.failedCount, batch.recordCount);
+
+	if (batch.transcode)
+	{
+		printf(", dropped: %zu", batch.droppedCount);
+	}
+
+	printf("\n");
+
+	if (collectStats)
+	{
+		writeIPConfigStats(&batch.stats, stderr);
+	}
+
+	deinitializeIPConfigBatch(&batch);
+	return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runEdit(int argumentCount, char *arguments[])
+{
+	struct IPConfigEdit edit = {0};
+	char *index = NULL;
+
+	if (argumentCount != 3)
+	{
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	edit.id = arguments[0];
+	edit.key = arguments[1];
+	edit.value = arguments[2];
+
+	if ((index = strchr(arguments[1], ':')))
+	{
+		*index++ = 0;
+		edit.occurrence = strtoul(index, NULL, 10);
+	}
+
+	if (!editPackedIPConfig(STDIN_FILENO, STDOUT_FILENO, &edit))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * The index is built in memory and renamed over the old one only once it
+ * is complete, so a failed build leaves the previous index in place.
+ */
+
+static bool createIndex(const char *path)
+{
+	struct IPConfigIndex index = {0};
+	FILE *stream = NULL;
+	char *contents = NULL;
+	size_t contentsSize = 0;
+	bool written = false;
+	bool replaced = false;
+
+	if (!buildIPConfigIndexFile(&index, stdin))
+	{
+		return false;
+	}
+
+	if (!(stream = open_memstream(&contents, &contentsSize)))
+	{
+		printLibraryError("open_memstream");
+		deinitializeIPConfigIndex(&index);
+		return false;
+	}
+
+	written = writeIPConfigIndex(&index, stream);
+	deinitializeIPConfigIndex(&index);
+
+	if (fclose(stream) == EOF)
+	{
+		printLibraryError("open_memstream");
+		written = false;
+	}
+
+	written = written && replaceFileIfChanged(path, contents, contentsSize,
+	                                          &replaced);
+	free(contents);
+
+	return written;
+}
+
+static bool lookUpIndex(const char *path, const char *id)
+{
+	struct IPConfigIndex index = {0};
+	struct IPConfig config = {0};
+	FILE *stream = fopen(path, "r");
+	bool found = false;
+
+	if (!stream)
+	{
+		printLibraryError(path);
+		return false;
+	}
+
+	if (!readIPConfigIndex(&index, stream))
+	{
+		fclose(stream);
+		return false;
+	}
+
+	fclose(stream);
+
+	found = readIndexedIPConfigRecord(&index, stdin, id, &config) ==
+	        ReadIPConfigRecordStatus &&
+	        writeUnpackedIPConfig(&config, stdout);
+
+	deinitializeIPConfigIndex(&index);
+	deinitializeIPConfig(&config);
+
+	return found;
+}
+
+static int runIndex(const char *path, const char *id)
+{
+	bool succeeded = id ? lookUpIndex(path, id) : createIndex(path);
+	return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runQuery(int termCount, char *terms[])
+{
+	struct IPConfigQuery query;
+	struct IPConfigReader reader = {0};
+	struct IPConfig config = {0};
+	bool queried = false;
+
+	initializeIPConfigQuery(&query);
+
+	if (!termCount)
+	{
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	for (int index = 0; index < termCount; index++)
+	{
+		if (!addIPConfigQueryTerm(&query, terms[index]))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!initializeMappedIPConfigReader(&reader, stdin))
+	{
+		return EXIT_FAILURE;
+	}
+
+	queried = queryIPConfig(&reader, &query, &config, stdout);
+	deinitializeIPConfigReader(&reader);
+	deinitializeIPConfig(&config);
+
+	return queried && query.matchCount ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool replaceIPConfigFile(const char *path, const char *contents,
+                                size_t size)
+{
+	bool replaced = false;
+
+	if (!replaceFileIfChanged(path, contents, size, &replaced))
+	{
+		return false;
+	}
+
+	printf("%s: %s\n", path, replaced ? "replaced" : "unchanged");
+	return true;
+}
+
+static int runDiff(enum IPConfigAddressMode addressMode, bool silent,
+                   int pathCount, char *paths[])
+{
+	struct IPConfigDiff diff;
+	bool equal = false;
+
+	if (pathCount != 2)
+	{
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	initializeIPConfigDiff(&diff, silent ? NULL : stdout);
+	diff.addressMode = addressMode;
+
+	if (!diffIPConfigFiles(&diff, paths[0], paths[1], &equal))
+	{
+		return 2;
+	}
+
+	return equal ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runWatch(const char *path, enum IPConfigAddressMode addressMode)
+{
+	struct IPConfigDiff diff;
+
+	initializeIPConfigDiff(&diff, stdout);
+	diff.addressMode = addressMode;
+
+	return watchIPConfigFile(&diff, path) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+struct VerifyCounts
+{
+	size_t fileCount;
+	size_t validCount;
+	size_t invalidCount;
+};
+
+static bool verifyDescriptor(int descriptor, const char *directory,
+                             const char *name, struct VerifyCounts *counts)
+{
+	struct IPConfigVerifier verifier;
+
+	counts->fileCount++;
+
+	if (verifyPackedIPConfigDescriptor(descriptor, &verifier))
+	{
+		counts->validCount++;
+		return true;
+	}
+
+	counts->invalidCount++;
+
+	if (!verifier.error)
+	{
+		return false;
+	}
+
+	printf("%s%s%s: %" PRIu64 ": %s\n", directory ? directory : "",
+	       directory ? "/" : "", name, verifier.fieldOffset, verifier.error);
+	return false;
+}
+
+static bool verifyFile(int directoryDescriptor, const char *directory,
+                       const char *name, struct VerifyCounts *counts)
+{
+	int descriptor = openat(directoryDescriptor, name, O_RDONLY);
+	bool verified = false;
+
+	if (descriptor == -1)
+	{
+		printLibraryError(name);
+		counts->fileCount++;
+		counts->invalidCount++;
+		return false;
+	}
+
+	verified = verifyDescriptor(descriptor, directory, name, counts);
+	close(descriptor);
+
+	return verified;
+}
+
+static bool verifyDirectory(const char *directory, struct VerifyCounts *counts)
+{
+	DIR *stream = opendir(directory);
+	struct dirent *entry = NULL;
+	bool verified = true;
+
+	if (!stream)
+	{
+		printLibraryError(directory);
+		return false;
+	}
+
+	while ((entry = readdir(stream)))
+	{
+		struct stat status;
+
+		if (entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		if (entry->d_type == DT_UNKNOWN)
+		{
+			if (fstatat(dirfd(stream), entry->d_name,
+			            &status, 0) == -1 ||
+			    !S_ISREG(status.st_mode))
+			{
+				continue;
+			}
+		}
+
+		else if (entry->d_type != DT_REG)
+		{
+			continue;
+		}
+
+		if (!verifyFile(dirfd(stream), directory, entry->d_name, counts))
+		{
+			verified = false;
+		}
+	}
+
+	closedir(stream);
+	return verified;
+}
+
+static int runVerify(int pathCount, char *paths[])
+{
+	struct VerifyCounts counts = {0};
+	bool verified = true;
+
+	if (!pathCount)
+	{
+		verified = verifyDescriptor(STDIN_FILENO, NULL, "stdin", &counts);
+	}
+
+	for (int index = 0; index < pathCount; index++)
+	{
+		struct stat status;
+		bool pathVerified = false;
+
+		if (stat(paths[index], &status) == -1)
+		{
+			printLibraryError(paths[index]);
+			return EXIT_FAILURE;
+		}
+
+		if (S_ISDIR(status.st_mode))
+		{
+			pathVerified = verifyDirectory(paths[index], &counts);
+		}
+
+		else
+		{
+			pathVerified = verifyFile(AT_FDCWD, NULL, paths[index], &counts);
+		}
+
+		verified = verified && pathVerified;
+	}
+
+	printf("files: %zu, valid: %zu, invalid: %zu\n", counts.fileCount,
+	       counts.validCount, counts.invalidCount);
+
+	return verified ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runServer(const char *path, enum IPConfigAddressMode addressMode,
+                     long threadCount)
+{
+	struct IPConfigServer server;
+	bool served = false;
+
+	initializeIPConfigServer(&server, path);
+	server.addressMode = addressMode;
+
+	if (threadCount > 0)
+	{
+		server.threadCount = threadCount;
+	}
+
+	served = runIPConfigServer(&server);
+	writeIPConfigServerCounters(&server.counters, stdout);
+
+	return served ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char *argv[])
 {
 	int option = 0;
+	int mode = 0;
+	uint32_t version = 0;
+	enum IPConfigAddressMode addressMode = OpaqueIPConfigAddressMode;
+
+	const char *outputDirectory = NULL;
+	const char *manifest = NULL;
+	long threadCount = 0;
+
+	const char *indexPath = NULL;
+	const char *id = NULL;
+	const char *socketPath = NULL;
+	const char *replacePath = NULL;
+	const char *watchPath = NULL;
+	char *contents = NULL;
+	size_t contentsSize = 0;
+	FILE *output = stdout;
+	bool silent = false;
+	bool json = false;
+	bool collectStats = false;
+	struct IPConfigStats stats = {0};
+	const struct option longOptions[] = {
+		{"stats", no_argument, NULL, IPConfigStatsOption},
+		{NULL, 0, NULL, 0}
+	};
+
+	struct IPConfigReader reader = {0};
+	struct IPConfigWriter writer = {0};
 	struct IPConfig config = {0};
+	bool converted = false;
 
-	option = getopt(argc, argv, "hp:u");
+	setIPConfigErrorStream(stderr);
 
-	if (option == 'h')
+	while ((option = getopt_long(argc, argv, "hp:ut:ecJw:qdsvW:x:r:S:o:m:j:",
+	                             longOptions, NULL)) != -1)
 	{
-		usage(stdout);
-		return EXIT_SUCCESS;
+		if (option == 'h')
+		{
+			usage(stdout);
+			return EXIT_SUCCESS;
+		}
+
+		else if (option == 'p' || option == 't')
+		{
+			mode = option;
+			version = *optarg - 0x30;
+		}
+
+		else if (option == 'u' || option == 'e' || option == 'q' ||
+		         option == 'd' || option == 'v')
+		{
+			mode = option;
+		}
+
+		else if (option == 'c')
+		{
+			addressMode = CanonicalIPConfigAddressMode;
+		}
+
+		else if (option == 's')
+		{
+			silent = true;
+		}
+
+		else if (option == 'J')
+		{
+			json = true;
+		}
+
+		else if (option == 'w')
+		{
+			replacePath = optarg;
+		}
+
+		else if (option == 'x')
+		{
+			mode = option;
+			indexPath = optarg;
+		}
+
+		else if (option == 'r')
+		{
+			id = optarg;
+		}
+
+		else if (option == 'W')
+		{
+			mode = option;
+			watchPath = optarg;
+		}
+
+		else if (option == 'S')
+		{
+			mode = option;
+			socketPath = optarg;
+		}
+
+		else if (option == 'o')
+		{
+			outputDirectory = optarg;
+		}
+
+		else if (option == 'm')
+		{
+			manifest = optarg;
+		}
+
+		else if (option == 'j')
+		{
+			threadCount = strtol(optarg, NULL, 10);
+		}
+
+		else if (option == IPConfigStatsOption)
+		{
+			collectStats = true;
+		}
+
+		else
+		{
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (mode == 'e')
+	{
+		return runEdit(argc - optind, argv + optind);
+	}
+
+	if (mode == 'q')
+	{
+		return runQuery(argc - optind, argv + optind);
+	}
+
+	if (mode == 'd')
+	{
+		return runDiff(addressMode, silent, argc - optind, argv + optind);
+	}
+
+	if (mode == 'v')
+	{
+		return runVerify(argc - optind, argv + optind);
+	}
+
+	if (mode == 'W')
+	{
+		return runWatch(watchPath, addressMode);
+	}
+
+	if (mode == 'x')
+	{
+		return runIndex(indexPath, id);
+	}
+
+	if (mode == 'S')
+	{
+		return runServer(socketPath, addressMode, threadCount);
 	}
 
-	else if (option == 'p')
+	if (!mode || (!outputDirectory && (manifest || optind < argc)))
 	{
-		config.version = *optarg - 0x30;
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
 
-		if (!readUnpackedIPConfig(stdin, &config))
+	if (outputDirectory)
+	{
+		return runBatch(mode, version, addressMode, outputDirectory,
+		                manifest, threadCount, json, collectStats,
+		                argc - optind, argv + optind);
+	}
+
+	if (replacePath && !(output = open_memstream(&contents, &contentsSize)))
+	{
+		printLibraryError("open_memstream");
+		return EXIT_FAILURE;
+	}
+
+	if (collectStats)
+	{
+		stats.fileCount = 1;
+		startIPConfigStats(&stats);
+	}
+
+	if (mode == 'p')
+	{
+		if (json && !initializeJSONIPConfigReader(&reader, stdin, version))
 		{
 			return EXIT_FAILURE;
 		}
 
-		if (!writePackedIPConfig(&config, stdout))
+		if (!json &&
+		    !initializeUnpackedIPConfigReader(&reader, stdin, version))
 		{
 			return EXIT_FAILURE;
 		}
 
-		deinitializeIPConfig(&config);
+		if (!initializePackedIPConfigWriter(&writer, output, version))
+		{
+			return EXIT_FAILURE;
+		}
 	}
 
-	else if (option == 'u')
+	else if (mode == 't')
 	{
-		if (!readPackedIPConfig(stdin, &config))
+		if (!initializeMappedIPConfigReader(&reader, stdin))
 		{
 			return EXIT_FAILURE;
 		}
 
-		if (!writeUnpackedIPConfig(&config, stdout))
+		if (!initializePackedIPConfigWriter(&writer, output, version))
 		{
 			return EXIT_FAILURE;
 		}
-
-		deinitializeIPConfig(&config);
 	}
 
 	else
 	{
-		usage(stderr);
-		return EXIT_FAILURE;
+		if (!initializeMappedIPConfigReader(&reader, stdin))
+		{
+			return EXIT_FAILURE;
+		}
+
+		if (json)
+		{
+			initializeJSONIPConfigWriter(&writer, output);
+		}
+
+		else
+		{
+			initializeUnpackedIPConfigWriter(&writer, output);
+		}
 	}
-	
-	return EXIT_SUCCESS;
+
+	reader.addressMode = addressMode;
+	writer.canonical = replacePath != NULL;
+	converted = convertIPConfig(&reader, &writer, &config);
+	deinitializeIPConfigReader(&reader);
+	deinitializeIPConfig(&config);
+
+	enterIPConfigStatsPhase(WriteIPConfigStatsPhase);
+
+	if (replacePath)
+	{
+		converted = fclose(output) != EOF && converted &&
+		            replaceIPConfigFile(replacePath, contents, contentsSize);
+		free(contents);
+	}
+
+	else if (fflush(output) == EOF)
+	{
+		printLibraryError("fflush");
+		converted = false;
+	}
+
+	if (collectStats)
+	{
+		stopIPConfigStats();
+		writeIPConfigStats(&stats, stderr);
+	}
+
+	return converted ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,339 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "data.h"
+#include "query.h"
+#include "ipconfig.h"
+#include "error.h"
+
+static struct IPConfigString IPConfigSelectionKey = {"key", 3};
+
+static bool isSameString(const struct IPConfigString *left,
+                         const struct IPConfigString *right)
+{
+	return left->length == right->length &&
+	       !memcmp(left->data, right->data, left->length);
+}
+
+void initializeIPConfigQuery(struct IPConfigQuery *query)
+{
+	memset(query, 0, sizeof *query);
+}
+
+bool addIPConfigQueryTerm(struct IPConfigQuery *query, const char *term)
+{
+	const char *separator = strchr(term, '=');
+	struct IPConfigQueryCondition *condition = NULL;
+	struct IPConfigString key;
+	struct IPConfigString value;
+
+	if (!separator || separator == term)
+	{
+		printError("malformed query term");
+		return false;
+	}
+
+	key.data = term;
+	key.length = separator - term;
+	value.data = separator + 1;
+	value.length = strlen(value.data);
+
+	if (isSameString(&key, &IPConfigSelectionKey))
+	{
+		query->key = value;
+		return true;
+	}
+
+	if (query->conditionCount == IPConfigQueryMaximumConditions)
+	{
+		printError("too many query conditions");
+		return false;
+	}
+
+	condition = &query->conditions[query->conditionCount++];
+	condition->key = key;
+	condition->value = value;
+
+	if (isSameString(&key, &IPConfigIdentifierKey))
+	{
+		query->first = true;
+	}
+
+	return true;
+}
+
+static bool matchInteger(const struct IPConfigString *expected,
+                         uint32_t integer)
+{
+	char buffer[IPConfigScratchCapacity];
+	char *terminator = NULL;
+
+	if (!expected->length || expected->length >= sizeof buffer)
+	{
+		return false;
+	}
+
+	memcpy(buffer, expected->data, expected->length);
+	buffer[expected->length] = 0;
+
+	return strtoul(buffer, &terminator, 10) == integer && !*terminator;
+}
+
+static bool matchValue(const struct IPConfigString *expected,
+                       enum IPConfigAttributeType type,
+                       const union IPConfigValue *value)
+{
+	if (type == IntegerIPConfigAttributeType)
+	{
+		return matchInteger(expected, value->integer);
+	}
+
+	return type == StringIPConfigAttributeType &&
+	       isSameString(expected, &value->string);
+}
+
+/*
+ * Only the values the query asks for are decoded.  Conditions are compared
+ * against the encoded bytes and everything else is skipped by its length,
+ * so a record that does not match costs no allocation at all.
+ */
+
+static bool matchCondition(struct IPConfigInput *input,
+                           const struct IPConfigString *expected,
+                           enum IPConfigAttributeType type, bool *matched)
+{
+	uint32_t integer = 0;
+
+	if (type == IntegerIPConfigAttributeType)
+	{
+		if (!readPackedUInt32(input, &integer))
+		{
+			return false;
+		}
+
+		*matched = matchInteger(expected, integer);
+		return true;
+	}
+
+	return matchPackedString(input, expected->data, expected->length,
+	                         matched);
+}
+
+static uint32_t getConditionMask(struct IPConfigQuery *query,
+                                 const struct IPConfigString *key)
+{
+	uint32_t mask = 0;
+
+	for (size_t index = 0; index < query->conditionCount; index++)
+	{
+		if (isSameString(&query->conditions[index].key, key))
+		{
+			mask |= (uint32_t) 1 << index;
+		}
+	}
+
+	return mask;
+}
+
+static uint32_t matchConditions(struct IPConfigQuery *query, uint32_t mask,
+                                enum IPConfigAttributeType type,
+                                const union IPConfigValue *value)
+{
+	uint32_t satisfied = 0;
+
+	for (size_t index = 0; index < query->conditionCount; index++)
+	{
+		if ((mask >> index & 1) &&
+		    matchValue(&query->conditions[index].value, type, value))
+		{
+			satisfied |= (uint32_t) 1 << index;
+		}
+	}
+
+	return satisfied;
+}
+
+enum IPConfigRecordStatus queryPackedIPConfigRecord(
+	struct IPConfigInput *input, struct IPConfigQuery *query,
+	struct IPConfig *config)
+{
+	uint32_t required = (uint32_t) ((1ull << query->conditionCount) - 1);
+	uint32_t satisfied = 0;
+
+	query->matched = false;
+	input->arena = &config->arena;
+
+	if (isPackedInputFinished(input))
+	{
+		return EndIPConfigRecordStatus;
+	}
+
+	while (true)
+	{
+		struct IPConfigString key;
+		enum IPConfigAttributeType type = InvalidIPConfigAttributeType;
+		char scratch[IPConfigScratchCapacity];
+		uint32_t mask = 0;
+
+		if (isPackedInputFinished(input))
+		{
+			printError("missing record terminator");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (!readPackedStringInto(input, scratch, sizeof scratch, &key))
+		{
+			printError("failed to read attribute key");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		type = getIPConfigAttributeType(config->version, &key);
+
+		if (type == InvalidIPConfigAttributeType)
+		{
+			printError("unrecognized attribute key");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		else if (type == TerminalIPConfigAttributeType)
+		{
+			break;
+		}
+
+		mask = getConditionMask(query, &key);
+
+		if (mask && type != IntegerIPConfigAttributeType &&
+		    type != StringIPConfigAttributeType)
+		{
+			printError("only integers and strings can be matched");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (query->key.data && isSameString(&key, &query->key))
+		{
+			struct IPConfigAttribute *attribute = NULL;
+
+			if (!(attribute = appendIPConfigAttribute(config)) ||
+			    !readPackedValue(input, type, &attribute->value))
+			{
+				printError("failed to read value");
+				deinitializeIPConfig(config);
+				return FailedIPConfigRecordStatus;
+			}
+
+			attribute->key = query->key;
+			attribute->type = type;
+
+			satisfied |= matchConditions(query, mask, type,
+			                             &attribute->value);
+		}
+
+		else if (mask & (mask - 1))
+		{
+			union IPConfigValue value;
+
+			if (!readPackedValue(input, type, &value))
+			{
+				printError("failed to read value");
+				deinitializeIPConfig(config);
+				return FailedIPConfigRecordStatus;
+			}
+
+			satisfied |= matchConditions(query, mask, type, &value);
+		}
+
+		else if (mask)
+		{
+			size_t index = 0;
+			bool matched = false;
+
+			while (!(mask >> index & 1))
+			{
+				index++;
+			}
+
+			if (!matchCondition(input, &query->conditions[index].value,
+			                    type, &matched))
+			{
+				printError("failed to read value");
+				deinitializeIPConfig(config);
+				return FailedIPConfigRecordStatus;
+			}
+
+			if (matched)
+			{
+				satisfied |= mask;
+			}
+		}
+
+		else if (!skipPackedValue(input, type))
+		{
+			printError("failed to skip value");
+			deinitializeIPConfig(config);
+			return FailedIPConfigRecordStatus;
+		}
+
+		if (!query->key.data && satisfied == required)
+		{
+			break;
+		}
+	}
+
+	query->matched = satisfied == required;
+	query->matchCount += query->matched;
+
+	return ReadIPConfigRecordStatus;
+}
+
+bool queryIPConfig(struct IPConfigReader *reader, struct IPConfigQuery *query,
+                   struct IPConfig *config, FILE *stream)
+{
+	enum IPConfigRecordStatus status = EndIPConfigRecordStatus;
+	bool first = query->first || !query->key.data;
+
+	if (!reader->packed)
+	{
+		printError("queries need packed input");
+		return false;
+	}
+
+	config->version = reader->version;
+
+	while ((status = queryPackedIPConfigRecord(&reader->input, query,
+	                                           config)) ==
+	       ReadIPConfigRecordStatus)
+	{
+		bool written = true;
+
+		for (size_t index = 0; query->matched &&
+		     index < config->attributeCount; index++)
+		{
+			written = written &&
+			          writeUnpackedIPConfigValue(&config->attributes[index],
+			                                     stream);
+		}
+
+		resetIPConfig(config);
+
+		if (!written)
+		{
+			return false;
+		}
+
+		if (query->matched && first)
+		{
+			break;
+		}
+	}
+
+	resetIPConfig(config);
+	return status != FailedIPConfigRecordStatus;
+}
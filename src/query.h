@@ -0,0 +1,39 @@
+#ifndef IPCONFIG_QUERY_H
+#define IPCONFIG_QUERY_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ipconfig.h"
+
+#define IPConfigQueryMaximumConditions 32
+
+struct IPConfigQueryCondition
+{
+	struct IPConfigString key;
+	struct IPConfigString value;
+};
+
+struct IPConfigQuery
+{
+	struct IPConfigQueryCondition conditions[IPConfigQueryMaximumConditions];
+	size_t conditionCount;
+	struct IPConfigString key;
+
+	bool first;
+	bool matched;
+	size_t matchCount;
+};
+
+void initializeIPConfigQuery(struct IPConfigQuery *query);
+bool addIPConfigQueryTerm(struct IPConfigQuery *query, const char *term);
+
+enum IPConfigRecordStatus queryPackedIPConfigRecord(
+	struct IPConfigInput *input, struct IPConfigQuery *query,
+	struct IPConfig *config);
+bool queryIPConfig(struct IPConfigReader *reader, struct IPConfigQuery *query,
+                   struct IPConfig *config, FILE *stream);
+
+#endif
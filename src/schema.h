@@ -0,0 +1,39 @@
+#ifndef IPCONFIG_SCHEMA_H
+#define IPCONFIG_SCHEMA_H
+
+/*
+ * The one description of every file version.  Each attribute row gives its
+ * key, the kind of address it holds and, through the column selector V,
+ * its type in each version, in the order Android writes them.  A new
+ * version is one more entry in IPConfigSchemaVersions, one more column in
+ * every row and its selector below.
+ */
+
+#define IPConfigSchemaVersions(X) X(1) X(2) X(3)
+
+#define IPConfigAttributeSchema(X, V) \
+	X(id,            No,      V(Integer,  Integer,  String)) \
+	X(ipAssignment,  No,      V(String,   String,   String)) \
+	X(linkAddress,   Address, V(Link,     Link,     Link)) \
+	X(gateway,       Address, V(String,   Route,    Route)) \
+	X(dns,           Address, V(String,   String,   String)) \
+	X(proxySettings, No,      V(String,   String,   String)) \
+	X(proxyHost,     Host,    V(String,   String,   String)) \
+	X(proxyPort,     No,      V(Integer,  Integer,  Integer)) \
+	X(proxyPac,      No,      V(String,   String,   String)) \
+	X(exclusionList, No,      V(String,   String,   String)) \
+	X(eos,           No,      V(Terminal, Terminal, Terminal))
+
+#define selectIPConfigVersion1(v1, v2, v3) v1
+#define selectIPConfigVersion2(v1, v2, v3) v2
+#define selectIPConfigVersion3(v1, v2, v3) v3
+
+#define countIPConfigSchemaEntry(...) + 1
+
+#define IPConfigSchemaVersionCount \
+	(0 IPConfigSchemaVersions(countIPConfigSchemaEntry))
+#define IPConfigSchemaKeyCount \
+	(0 IPConfigAttributeSchema(countIPConfigSchemaEntry, \
+	                           selectIPConfigVersion1))
+
+#endif
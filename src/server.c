@@ -0,0 +1,609 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "query.h"
+#include "server.h"
+#include "ipconfig.h"
+#include "error.h"
+
+enum IPConfigServerCommand
+{
+	PackIPConfigServerCommand,
+	UnpackIPConfigServerCommand,
+	QueryIPConfigServerCommand,
+	StatsIPConfigServerCommand
+};
+
+struct IPConfigServerRequest
+{
+	enum IPConfigServerCommand command;
+	uint32_t version;
+	size_t size;
+
+	char *terms[IPConfigQueryMaximumConditions + 1];
+	size_t termCount;
+};
+
+struct IPConfigServerWorker
+{
+	struct IPConfigServerContext *context;
+	pthread_t thread;
+	int descriptor;
+};
+
+struct IPConfigServerContext
+{
+	struct IPConfigServer *server;
+	struct IPConfigServerWorker *workers;
+	size_t workerCount;
+
+	pthread_mutex_t lock;
+	int listener;
+	bool stopping;
+};
+
+void initializeIPConfigServer(struct IPConfigServer *server,
+                              const char *path)
+{
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	memset(server, 0, sizeof *server);
+	server->path = path;
+	server->threadCount = processorCount > 0 ? processorCount : 1;
+}
+
+void writeIPConfigServerCounters(const struct IPConfigServerCounters *counters,
+                                 FILE *stream)
+{
+	fprintf(stream, "connections: %zu, requests: %zu, packed: %zu, "
+	                "unpacked: %zu, queried: %zu, failed: %zu\n",
+	        counters->connectionCount, counters->requestCount,
+	        counters->packedCount, counters->unpackedCount,
+	        counters->queriedCount, counters->failedCount);
+}
+
+static bool parseNumber(const char *text, unsigned long long maximum,
+                        unsigned long long *number)
+{
+	char *terminator = NULL;
+
+	if (!text || *text < '0' || *text > '9')
+	{
+		return false;
+	}
+
+	*number = strtoull(text, &terminator, 10);
+	return !*terminator && *number <= maximum;
+}
+
+/*
+ * A request is one header line naming the command, followed by exactly as
+ * many payload bytes as the header announces:
+ *
+ *   pack VERSION SIZE
+ *   unpack SIZE
+ *   query SIZE TERM...
+ *   stats
+ */
+
+static bool parseRequest(char *line, struct IPConfigServerRequest *request)
+{
+	char *position = NULL;
+	char *command = strtok_r(line, " \n", &position);
+	unsigned long long number = 0;
+
+	memset(request, 0, sizeof *request);
+
+	if (!command)
+	{
+		return false;
+	}
+
+	if (!strcmp(command, "stats"))
+	{
+		request->command = StatsIPConfigServerCommand;
+		return !strtok_r(NULL, " \n", &position);
+	}
+
+	if (!strcmp(command, "pack"))
+	{
+		request->command = PackIPConfigServerCommand;
+
+		if (!parseNumber(strtok_r(NULL, " \n", &position), UINT32_MAX,
+		                 &number))
+		{
+			return false;
+		}
+
+		request->version = number;
+	}
+
+	else if (!strcmp(command, "unpack"))
+	{
+		request->command = UnpackIPConfigServerCommand;
+	}
+
+	else if (!strcmp(command, "query"))
+	{
+		request->command = QueryIPConfigServerCommand;
+	}
+
+	else
+	{
+		return false;
+	}
+
+	if (!parseNumber(strtok_r(NULL, " \n", &position),
+	                 IPConfigServerMaximumPayloadSize, &number))
+	{
+		return false;
+	}
+
+	request->size = number;
+
+	while ((request->terms[request->termCount] =
+	        strtok_r(NULL, " \n", &position)))
+	{
+		if (request->command != QueryIPConfigServerCommand ||
+		    ++request->termCount > IPConfigQueryMaximumConditions)
+		{
+			return false;
+		}
+	}
+
+	return request->command != QueryIPConfigServerCommand ||
+	       request->termCount;
+}
+
+static bool handleQuery(struct IPConfigServerRequest *request,
+                        const char *payload, struct IPConfig *config,
+                        FILE *output, size_t *recordCount)
+{
+	struct IPConfigReader reader = {0};
+	struct IPConfigQuery query;
+	bool handled = false;
+
+	initializeIPConfigQuery(&query);
+
+	for (size_t index = 0; index < request->termCount; index++)
+	{
+		if (!addIPConfigQueryTerm(&query, request->terms[index]))
+		{
+			return false;
+		}
+	}
+
+	if (!initializeBufferIPConfigReader(&reader, payload, request->size))
+	{
+		return false;
+	}
+
+	handled = queryIPConfig(&reader, &query, config, output);
+	deinitializeIPConfigReader(&reader);
+	*recordCount = query.matchCount;
+
+	return handled;
+}
+
+static bool handleRequest(struct IPConfigServerContext *context,
+                          struct IPConfigServerRequest *request,
+                          const char *payload, struct IPConfig *config,
+                          FILE *output, size_t *recordCount)
+{
+	struct IPConfigReader reader = {0};
+	struct IPConfigWriter writer = {0};
+	FILE *input = NULL;
+	bool handled = false;
+
+	if (request->command == StatsIPConfigServerCommand)
+	{
+		struct IPConfigServerCounters counters;
+
+		pthread_mutex_lock(&context->lock);
+		counters = context->server->counters;
+		pthread_mutex_unlock(&context->lock);
+
+		writeIPConfigServerCounters(&counters, output);
+		return true;
+	}
+
+	if (request->command == QueryIPConfigServerCommand)
+	{
+		return handleQuery(request, payload, config, output, recordCount);
+	}
+
+	if (request->command == PackIPConfigServerCommand)
+	{
+		if (!(input = fmemopen((void *) payload, request->size, "r")))
+		{
+			printLibraryError("fmemopen");
+			return false;
+		}
+
+		handled = initializeUnpackedIPConfigReader(&reader, input,
+		                                           request->version) &&
+		          initializePackedIPConfigWriter(&writer, output,
+		                                         request->version);
+	}
+
+	else
+	{
+		handled = initializeBufferIPConfigReader(&reader, payload,
+		                                         request->size);
+		initializeUnpackedIPConfigWriter(&writer, output);
+	}
+
+	reader.addressMode = context->server->addressMode;
+	handled = handled && convertIPConfig(&reader, &writer, config);
+	deinitializeIPConfigReader(&reader);
+
+	if (input)
+	{
+		fclose(input);
+	}
+
+	*recordCount = writer.recordCount;
+	return handled;
+}
+
+static void countRequest(struct IPConfigServerContext *context,
+                         enum IPConfigServerCommand command, bool handled)
+{
+	struct IPConfigServerCounters *counters = &context->server->counters;
+
+	pthread_mutex_lock(&context->lock);
+	counters->requestCount++;
+
+	if (!handled)
+	{
+		counters->failedCount++;
+	}
+
+	else if (command == PackIPConfigServerCommand)
+	{
+		counters->packedCount++;
+	}
+
+	else if (command == UnpackIPConfigServerCommand)
+	{
+		counters->unpackedCount++;
+	}
+
+	else if (command == QueryIPConfigServerCommand)
+	{
+		counters->queriedCount++;
+	}
+
+	pthread_mutex_unlock(&context->lock);
+}
+
+static bool sendAll(int descriptor, const void *data, size_t size)
+{
+	const char *position = data;
+
+	while (size)
+	{
+		ssize_t sent = send(descriptor, position, size, MSG_NOSIGNAL);
+
+		if (sent == -1)
+		{
+			return false;
+		}
+
+		position += sent;
+		size -= sent;
+	}
+
+	return true;
+}
+
+/*
+ * Every request is answered with "ok SIZE RECORDS" and SIZE bytes of
+ * output, RECORDS being the records written or matched, or with
+ * "error MESSAGE" when the conversion failed.  A malformed header also
+ * closes the connection, since the payload that follows cannot be found.
+ */
+
+static bool sendResponse(int descriptor, bool handled, const char *body,
+                         size_t size, size_t recordCount)
+{
+	char header[IPConfigServerMaximumHeaderLength];
+	int length = 0;
+
+	if (handled)
+	{
+		length = snprintf(header, sizeof header, "ok %zu %zu\n",
+		                  size, recordCount);
+	}
+
+	else
+	{
+		length = snprintf(header, sizeof header, "error %s\n",
+		                  getIPConfigError()->message);
+	}
+
+	if (length < 0 || (size_t) length >= sizeof header)
+	{
+		return false;
+	}
+
+	return sendAll(descriptor, header, length) &&
+	       (!handled || sendAll(descriptor, body, size));
+}
+
+static void serveConnection(struct IPConfigServerWorker *worker,
+                            struct IPConfig *config)
+{
+	struct IPConfigServerContext *context = worker->context;
+	FILE *input = fdopen(worker->descriptor, "r");
+	char *line = NULL;
+	size_t lineCapacity = 0;
+	ssize_t lineLength = 0;
+
+	while (input && (lineLength = getline(&line, &lineCapacity, input)) > 0)
+	{
+		struct IPConfigServerRequest request;
+		char *payload = NULL;
+		char *body = NULL;
+		size_t bodySize = 0;
+		size_t recordCount = 0;
+		FILE *output = NULL;
+		bool handled = false;
+		bool sent = false;
+
+		clearIPConfigError();
+
+		if (lineLength > IPConfigServerMaximumHeaderLength ||
+		    !parseRequest(line, &request))
+		{
+			printError("malformed request");
+			countRequest(context, StatsIPConfigServerCommand, false);
+			sendResponse(worker->descriptor, false, NULL, 0, 0);
+			break;
+		}
+
+		if (!(payload = malloc(request.size + 1)))
+		{
+			printLibraryError("malloc");
+			break;
+		}
+
+		if (fread(payload, 1, request.size, input) != request.size)
+		{
+			free(payload);
+			break;
+		}
+
+		if (!(output = open_memstream(&body, &bodySize)))
+		{
+			printLibraryError("open_memstream");
+		}
+
+		else
+		{
+			handled = handleRequest(context, &request, payload, config,
+			                        output, &recordCount);
+
+			if (fclose(output) == EOF)
+			{
+				printLibraryError("fclose");
+				handled = false;
+			}
+		}
+
+		resetIPConfig(config);
+		countRequest(context, request.command, handled);
+		sent = sendResponse(worker->descriptor, handled, body, bodySize,
+		                    recordCount);
+
+		free(body);
+		free(payload);
+
+		if (!sent)
+		{
+			break;
+		}
+	}
+
+	free(line);
+
+	pthread_mutex_lock(&context->lock);
+
+	if (!input)
+	{
+		close(worker->descriptor);
+	}
+
+	worker->descriptor = -1;
+	pthread_mutex_unlock(&context->lock);
+
+	if (input)
+	{
+		fclose(input);
+	}
+}
+
+static void *runWorker(void *context)
+{
+	struct IPConfigServerWorker *worker = context;
+	struct IPConfigServerContext *server = worker->context;
+	struct IPConfig config = {0};
+
+	for (;;)
+	{
+		int descriptor = accept(server->listener, NULL, NULL);
+		bool stopping = false;
+
+		pthread_mutex_lock(&server->lock);
+		stopping = server->stopping;
+
+		if (descriptor != -1 && !stopping)
+		{
+			worker->descriptor = descriptor;
+			server->server->counters.connectionCount++;
+		}
+
+		pthread_mutex_unlock(&server->lock);
+
+		if (stopping)
+		{
+			if (descriptor != -1)
+			{
+				close(descriptor);
+			}
+
+			break;
+		}
+
+		if (descriptor == -1)
+		{
+			if (errno != EINTR && errno != ECONNABORTED)
+			{
+				printLibraryError("accept");
+				break;
+			}
+
+			continue;
+		}
+
+		serveConnection(worker, &config);
+	}
+
+	deinitializeIPConfig(&config);
+	return NULL;
+}
+
+static bool openListener(const char *path, int *listener)
+{
+	struct sockaddr_un address;
+	struct stat status;
+
+	memset(&address, 0, sizeof address);
+	address.sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof address.sun_path)
+	{
+		printError("socket path too long");
+		return false;
+	}
+
+	strcpy(address.sun_path, path);
+
+	if (lstat(path, &status) == 0 && S_ISSOCK(status.st_mode))
+	{
+		unlink(path);
+	}
+
+	if ((*listener = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+	{
+		printLibraryError("socket");
+		return false;
+	}
+
+	if (bind(*listener, (struct sockaddr *) &address, sizeof address) == -1 ||
+	    listen(*listener, SOMAXCONN) == -1)
+	{
+		printLibraryError(path);
+		close(*listener);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Workers block in accept on the shared socket and serve one connection at
+ * a time, keeping their config and its arena between requests.  The
+ * calling thread waits for SIGINT or SIGTERM, then shuts the listener and
+ * every open connection down so that the workers return.
+ */
+
+bool runIPConfigServer(struct IPConfigServer *server)
+{
+	struct IPConfigServerContext context;
+	sigset_t signals;
+	sigset_t previousSignals;
+	size_t startedCount = 0;
+	int signal = 0;
+
+	memset(&context, 0, sizeof context);
+	context.server = server;
+	context.workerCount = server->threadCount ? server->threadCount : 1;
+	context.workers = calloc(context.workerCount, sizeof *context.workers);
+
+	if (!context.workers)
+	{
+		printLibraryError("calloc");
+		return false;
+	}
+
+	if (!openListener(server->path, &context.listener))
+	{
+		free(context.workers);
+		return false;
+	}
+
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, &previousSignals);
+	pthread_mutex_init(&context.lock, NULL);
+
+	for (; startedCount < context.workerCount; startedCount++)
+	{
+		struct IPConfigServerWorker *worker = &context.workers[startedCount];
+
+		worker->context = &context;
+		worker->descriptor = -1;
+
+		if (pthread_create(&worker->thread, NULL, runWorker, worker))
+		{
+			printError("failed to start worker");
+			break;
+		}
+	}
+
+	if (startedCount)
+	{
+		sigwait(&signals, &signal);
+	}
+
+	pthread_mutex_lock(&context.lock);
+	context.stopping = true;
+	shutdown(context.listener, SHUT_RDWR);
+
+	for (size_t identifier = 0; identifier < startedCount; identifier++)
+	{
+		if (context.workers[identifier].descriptor != -1)
+		{
+			shutdown(context.workers[identifier].descriptor, SHUT_RDWR);
+		}
+	}
+
+	pthread_mutex_unlock(&context.lock);
+
+	for (size_t identifier = 0; identifier < startedCount; identifier++)
+	{
+		pthread_join(context.workers[identifier].thread, NULL);
+	}
+
+	pthread_mutex_destroy(&context.lock);
+	pthread_sigmask(SIG_SETMASK, &previousSignals, NULL);
+	close(context.listener);
+	unlink(server->path);
+	free(context.workers);
+
+	return startedCount > 0;
+}
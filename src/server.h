@@ -0,0 +1,39 @@
+#ifndef IPCONFIG_SERVER_H
+#define IPCONFIG_SERVER_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ipconfig.h"
+
+#define IPConfigServerMaximumHeaderLength 4096
+#define IPConfigServerMaximumPayloadSize (64 << 20)
+
+struct IPConfigServerCounters
+{
+	size_t connectionCount;
+	size_t requestCount;
+	size_t packedCount;
+	size_t unpackedCount;
+	size_t queriedCount;
+	size_t failedCount;
+};
+
+struct IPConfigServer
+{
+	const char *path;
+	size_t threadCount;
+	enum IPConfigAddressMode addressMode;
+
+	struct IPConfigServerCounters counters;
+};
+
+void initializeIPConfigServer(struct IPConfigServer *server,
+                              const char *path);
+bool runIPConfigServer(struct IPConfigServer *server);
+void writeIPConfigServerCounters(const struct IPConfigServerCounters *counters,
+                                 FILE *stream);
+
+#endif
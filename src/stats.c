@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+struct IPConfigStatsCollector
+{
+	struct IPConfigStats *stats;
+	enum IPConfigStatsPhase phase;
+	uint64_t wallNanoseconds;
+	uint64_t cpuNanoseconds;
+	uint64_t syscallCount;
+	bool syscallsCounted;
+};
+
+static const char *IPConfigStatsPhaseNames[IPConfigStatsPhaseCount] = {
+	"read", "decode", "encode", "write"
+};
+
+static const char *IPConfigStatsTypeNames[IPConfigStatsTypeCount] = {
+	"terminal", "integer", "string", "link", "route"
+};
+
+/*
+ * Like the last error, the collector belongs to the calling thread, so
+ * batch workers each fill their own statistics and never contend.
+ */
+
+static __thread struct IPConfigStatsCollector IPConfigCollector;
+
+static uint64_t readClock(clockid_t clock)
+{
+	struct timespec time;
+
+	if (clock_gettime(clock, &time) == -1)
+	{
+		return 0;
+	}
+
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/*
+ * Linux counts the read and write system calls of each thread, including
+ * the ones stdio makes on our behalf.  The read that fetches the counters
+ * is itself counted once they have been fetched.
+ */
+
+static bool readSyscallCount(uint64_t *count)
+{
+	int descriptor = open("/proc/thread-self/io", O_RDONLY);
+	char buffer[512];
+	ssize_t size = 0;
+	char *reads = NULL;
+	char *writes = NULL;
+
+	if (descriptor == -1)
+	{
+		return false;
+	}
+
+	size = read(descriptor, buffer, sizeof buffer - 1);
+	close(descriptor);
+
+	if (size <= 0)
+	{
+		return false;
+	}
+
+	buffer[size] = 0;
+	reads = strstr(buffer, "syscr: ");
+	writes = strstr(buffer, "syscw: ");
+
+	if (!reads || !writes)
+	{
+		return false;
+	}
+
+	*count = strtoull(reads + 7, NULL, 10) + strtoull(writes + 7, NULL, 10);
+	return true;
+}
+
+void startIPConfigStats(struct IPConfigStats *stats)
+{
+	struct IPConfigStatsCollector *collector = &IPConfigCollector;
+
+	collector->stats = stats;
+	collector->phase = NoIPConfigStatsPhase;
+	collector->syscallsCounted = readSyscallCount(&collector->syscallCount);
+}
+
+void stopIPConfigStats(void)
+{
+	struct IPConfigStatsCollector *collector = &IPConfigCollector;
+	uint64_t syscallCount = 0;
+
+	if (!collector->stats)
+	{
+		return;
+	}
+
+	enterIPConfigStatsPhase(NoIPConfigStatsPhase);
+
+	if (collector->syscallsCounted && readSyscallCount(&syscallCount) &&
+	    syscallCount > collector->syscallCount)
+	{
+		collector->stats->syscallCount += syscallCount -
+		                                  collector->syscallCount - 1;
+	}
+
+	collector->stats = NULL;
+}
+
+void addIPConfigStats(struct IPConfigStats *total,
+                      const struct IPConfigStats *stats)
+{
+	total->fileCount += stats->fileCount;
+	total->recordCount += stats->recordCount;
+	total->bytesRead += stats->bytesRead;
+	total->bytesWritten += stats->bytesWritten;
+
+	for (size_t index = 0; index < IPConfigStatsTypeCount; index++)
+	{
+		total->attributeCounts[index] += stats->attributeCounts[index];
+	}
+
+	total->allocationCount += stats->allocationCount;
+	total->allocatedBytes += stats->allocatedBytes;
+	total->arenaAllocationCount += stats->arenaAllocationCount;
+	total->arenaAllocatedBytes += stats->arenaAllocatedBytes;
+	total->syscallCount += stats->syscallCount;
+
+	for (size_t index = 0; index < IPConfigStatsPhaseCount; index++)
+	{
+		const struct IPConfigPhaseTime *phase = &stats->phases[index];
+
+		total->phases[index].wallNanoseconds += phase->wallNanoseconds;
+		total->phases[index].cpuNanoseconds += phase->cpuNanoseconds;
+	}
+}
+
+bool writeIPConfigStats(const struct IPConfigStats *stats, FILE *stream)
+{
+	fprintf(stream, "{\"files\": %" PRIu64 ", \"records\": %" PRIu64
+	                ", \"bytesRead\": %" PRIu64
+	                ", \"bytesWritten\": %" PRIu64 ", \"attributes\": {",
+	        stats->fileCount, stats->recordCount,
+	        stats->bytesRead, stats->bytesWritten);
+
+	for (size_t index = 1; index < IPConfigStatsTypeCount; index++)
+	{
+		fprintf(stream, "%s\"%s\": %" PRIu64, index > 1 ? ", " : "",
+		        IPConfigStatsTypeNames[index],
+		        stats->attributeCounts[index]);
+	}
+
+	fprintf(stream, "}, \"allocations\": %" PRIu64
+	                ", \"allocatedBytes\": %" PRIu64
+	                ", \"arenaAllocations\": %" PRIu64
+	                ", \"arenaAllocatedBytes\": %" PRIu64
+	                ", \"syscalls\": %" PRIu64 ", \"phases\": {",
+	        stats->allocationCount, stats->allocatedBytes,
+	        stats->arenaAllocationCount, stats->arenaAllocatedBytes,
+	        stats->syscallCount);
+
+	for (size_t index = 0; index < IPConfigStatsPhaseCount; index++)
+	{
+		const struct IPConfigPhaseTime *phase = &stats->phases[index];
+
+		fprintf(stream, "%s\"%s\": {\"wallNanoseconds\": %" PRIu64
+		                ", \"cpuNanoseconds\": %" PRIu64 "}",
+		        index ? ", " : "", IPConfigStatsPhaseNames[index],
+		        phase->wallNanoseconds, phase->cpuNanoseconds);
+	}
+
+	fprintf(stream, "}}\n");
+	return !ferror(stream);
+}
+
+/*
+ * Time is charged to one phase at a time: entering a phase closes the one
+ * in progress, and the caller restores it by entering the phase returned.
+ */
+
+enum IPConfigStatsPhase enterIPConfigStatsPhase(enum IPConfigStatsPhase phase)
+{
+	struct IPConfigStatsCollector *collector = &IPConfigCollector;
+	enum IPConfigStatsPhase previous = collector->phase;
+	uint64_t wallNanoseconds = 0;
+	uint64_t cpuNanoseconds = 0;
+
+	if (!collector->stats || phase == previous)
+	{
+		return previous;
+	}
+
+	wallNanoseconds = readClock(CLOCK_MONOTONIC);
+	cpuNanoseconds = readClock(CLOCK_THREAD_CPUTIME_ID);
+
+	if (previous != NoIPConfigStatsPhase)
+	{
+		struct IPConfigPhaseTime *time = &collector->stats->phases[previous];
+
+		time->wallNanoseconds += wallNanoseconds -
+		                         collector->wallNanoseconds;
+		time->cpuNanoseconds += cpuNanoseconds - collector->cpuNanoseconds;
+	}
+
+	collector->phase = phase;
+	collector->wallNanoseconds = wallNanoseconds;
+	collector->cpuNanoseconds = cpuNanoseconds;
+
+	return previous;
+}
+
+void countIPConfigBytesRead(size_t size)
+{
+	if (IPConfigCollector.stats)
+	{
+		IPConfigCollector.stats->bytesRead += size;
+	}
+}
+
+void countIPConfigBytesWritten(size_t size)
+{
+	if (IPConfigCollector.stats)
+	{
+		IPConfigCollector.stats->bytesWritten += size;
+	}
+}
+
+void countIPConfigAttribute(enum IPConfigAttributeType type)
+{
+	if (IPConfigCollector.stats && type >= 0 &&
+	    type < IPConfigStatsTypeCount)
+	{
+		IPConfigCollector.stats->attributeCounts[type]++;
+	}
+}
+
+void countIPConfigRecord(void)
+{
+	if (IPConfigCollector.stats)
+	{
+		IPConfigCollector.stats->recordCount++;
+	}
+}
+
+void countIPConfigAllocation(size_t size)
+{
+	if (IPConfigCollector.stats)
+	{
+		IPConfigCollector.stats->allocationCount++;
+		IPConfigCollector.stats->allocatedBytes += size;
+	}
+}
+
+void countIPConfigArenaAllocation(size_t size)
+{
+	if (IPConfigCollector.stats)
+	{
+		IPConfigCollector.stats->arenaAllocationCount++;
+		IPConfigCollector.stats->arenaAllocatedBytes += size;
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef IPCONFIG_STATS_H
+#define IPCONFIG_STATS_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ipconfig.h"
+
+enum IPConfigStatsPhase
+{
+	NoIPConfigStatsPhase = -1,
+	ReadIPConfigStatsPhase = 0,
+	DecodeIPConfigStatsPhase = 1,
+	EncodeIPConfigStatsPhase = 2,
+	WriteIPConfigStatsPhase = 3
+};
+
+#define IPConfigStatsPhaseCount 4
+#define IPConfigStatsTypeCount 5
+
+struct IPConfigPhaseTime
+{
+	uint64_t wallNanoseconds;
+	uint64_t cpuNanoseconds;
+};
+
+struct IPConfigStats
+{
+	uint64_t fileCount;
+	uint64_t recordCount;
+	uint64_t bytesRead;
+	uint64_t bytesWritten;
+	uint64_t attributeCounts[IPConfigStatsTypeCount];
+
+	uint64_t allocationCount;
+	uint64_t allocatedBytes;
+	uint64_t arenaAllocationCount;
+	uint64_t arenaAllocatedBytes;
+	uint64_t syscallCount;
+
+	struct IPConfigPhaseTime phases[IPConfigStatsPhaseCount];
+};
+
+/*
+ * Statistics are collected per thread, into the structure most recently
+ * passed to startIPConfigStats, until stopIPConfigStats.  Without one every
+ * hook below returns at once.
+ */
+
+void startIPConfigStats(struct IPConfigStats *stats);
+void stopIPConfigStats(void);
+void addIPConfigStats(struct IPConfigStats *total,
+                      const struct IPConfigStats *stats);
+bool writeIPConfigStats(const struct IPConfigStats *stats, FILE *stream);
+
+enum IPConfigStatsPhase enterIPConfigStatsPhase(enum IPConfigStatsPhase phase);
+void countIPConfigBytesRead(size_t size);
+void countIPConfigBytesWritten(size_t size);
+void countIPConfigAttribute(enum IPConfigAttributeType type);
+void countIPConfigRecord(void);
+void countIPConfigAllocation(size_t size);
+void countIPConfigArenaAllocation(size_t size);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef IPCONFIG_TRACE_H
+#define IPCONFIG_TRACE_H
+
+/*
+ * Static tracepoints for perf and bpftrace, compiled in with TRACE=1.
+ * Each probe is a single no-op instruction until a tracer attaches.  The
+ * default build compiles them away, only naming their arguments so that
+ * values kept for a probe never count as unused.
+ */
+
+#ifdef IPCONFIG_TRACE
+
+#include <sys/sdt.h>
+
+#define traceIPConfig1(name, a) \
+	DTRACE_PROBE1(ipconfigstore, name, a)
+#define traceIPConfig2(name, a, b) \
+	DTRACE_PROBE2(ipconfigstore, name, a, b)
+#define traceIPConfig3(name, a, b, c) \
+	DTRACE_PROBE3(ipconfigstore, name, a, b, c)
+#define traceIPConfig4(name, a, b, c, d) \
+	DTRACE_PROBE4(ipconfigstore, name, a, b, c, d)
+
+#else
+
+#define traceIPConfig1(name, a) \
+	((void) sizeof (a))
+#define traceIPConfig2(name, a, b) \
+	((void) sizeof (a), (void) sizeof (b))
+#define traceIPConfig3(name, a, b, c) \
+	((void) sizeof (a), (void) sizeof (b), (void) sizeof (c))
+#define traceIPConfig4(name, a, b, c, d) \
+	((void) sizeof (a), (void) sizeof (b), (void) sizeof (c), \
+	 (void) sizeof (d))
+
+#endif
+
+#endif
@@ -0,0 +1,363 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "verify.h"
+#include "ipconfig.h"
+#include "error.h"
+#include "schema.h"
+
+#define IPConfigVerifierBufferSize 65536
+
+static const uint32_t IPConfigVerifierMinimumVersion = 1;
+static const uint32_t IPConfigVerifierMaximumVersion =
+	IPConfigSchemaVersionCount;
+
+/*
+ * The packed encoding is walked one field at a time.  Numbers are gathered
+ * a byte at a time, string contents are skipped by advancing past them, and
+ * only keys are kept, in a buffer as long as the longest valid key.  Input
+ * may arrive in pieces of any size, and nothing is ever allocated.
+ */
+
+void initializeIPConfigVerifier(struct IPConfigVerifier *verifier)
+{
+	memset(verifier, 0, sizeof *verifier);
+	verifier->state = VersionIPConfigVerifierState;
+	verifier->needed = sizeof(uint32_t);
+}
+
+static size_t getFieldSize(enum IPConfigVerifierState state)
+{
+	switch (state)
+	{
+		case KeyLengthIPConfigVerifierState:
+		case KeyPaddingIPConfigVerifierState:
+		case StringLengthIPConfigVerifierState:
+		case StringPaddingIPConfigVerifierState:
+			return sizeof(uint16_t);
+
+		default:
+			return sizeof(uint32_t);
+	}
+}
+
+static void expectField(struct IPConfigVerifier *verifier,
+                        enum IPConfigVerifierState state, size_t size)
+{
+	verifier->state = state;
+	verifier->needed = size;
+	verifier->value = 0;
+}
+
+static void beginField(struct IPConfigVerifier *verifier,
+                       enum IPConfigVerifierState state)
+{
+	verifier->fieldOffset = verifier->offset;
+	expectField(verifier, state, getFieldSize(state));
+}
+
+static void beginString(struct IPConfigVerifier *verifier,
+                        enum IPConfigVerifierState next)
+{
+	verifier->next = next;
+	beginField(verifier, StringLengthIPConfigVerifierState);
+}
+
+static bool fail(struct IPConfigVerifier *verifier, const char *error)
+{
+	verifier->error = error;
+	return false;
+}
+
+static bool completeKey(struct IPConfigVerifier *verifier)
+{
+	struct IPConfigString key = {verifier->key, verifier->keyLength};
+	enum IPConfigAttributeType type = getIPConfigAttributeType(
+		verifier->version, &key);
+
+	switch (type)
+	{
+		case TerminalIPConfigAttributeType:
+			verifier->inRecord = false;
+			verifier->recordCount++;
+			beginField(verifier, KeyLengthIPConfigVerifierState);
+			return true;
+
+		case IntegerIPConfigAttributeType:
+			beginField(verifier, IntegerIPConfigVerifierState);
+			return true;
+
+		case StringIPConfigAttributeType:
+			beginString(verifier, KeyLengthIPConfigVerifierState);
+			return true;
+
+		case LinkIPConfigAttributeType:
+			beginString(verifier, LinkPrefixIPConfigVerifierState);
+			return true;
+
+		case RouteIPConfigAttributeType:
+			beginField(verifier, DestinationFlagIPConfigVerifierState);
+			return true;
+
+		default:
+			return fail(verifier, "unrecognized attribute key");
+	}
+}
+
+static bool completeField(struct IPConfigVerifier *verifier)
+{
+	uint32_t value = verifier->value;
+
+	switch (verifier->state)
+	{
+		case VersionIPConfigVerifierState:
+			if (value < IPConfigVerifierMinimumVersion ||
+			    value > IPConfigVerifierMaximumVersion)
+			{
+				return fail(verifier, "unrecognized file version");
+			}
+
+			verifier->version = value;
+			beginField(verifier, KeyLengthIPConfigVerifierState);
+			return true;
+
+		case KeyLengthIPConfigVerifierState:
+			verifier->inRecord = true;
+
+			if (!value)
+			{
+				expectField(verifier, KeyPaddingIPConfigVerifierState,
+				            sizeof(uint16_t));
+				return true;
+			}
+
+			if (value >= IPConfigVerifierKeyCapacity)
+			{
+				return fail(verifier, "unrecognized attribute key");
+			}
+
+			verifier->keyLength = 0;
+			expectField(verifier, KeyIPConfigVerifierState, value);
+			return true;
+
+		case KeyPaddingIPConfigVerifierState:
+			expectField(verifier, KeyLengthIPConfigVerifierState,
+			            sizeof(uint16_t));
+			return true;
+
+		case KeyIPConfigVerifierState:
+			return completeKey(verifier);
+
+		case StringLengthIPConfigVerifierState:
+			if (!value)
+			{
+				expectField(verifier, StringPaddingIPConfigVerifierState,
+				            sizeof(uint16_t));
+			}
+
+			else
+			{
+				expectField(verifier, StringIPConfigVerifierState, value);
+			}
+
+			return true;
+
+		case StringPaddingIPConfigVerifierState:
+			expectField(verifier, StringLengthIPConfigVerifierState,
+			            sizeof(uint16_t));
+			return true;
+
+		case StringIPConfigVerifierState:
+			beginField(verifier, verifier->next);
+			return true;
+
+		case DestinationFlagIPConfigVerifierState:
+			if (value > 1)
+			{
+				return fail(verifier, "invalid route destination flag");
+			}
+
+			if (value)
+			{
+				beginString(verifier, DestinationPrefixIPConfigVerifierState);
+			}
+
+			else
+			{
+				beginField(verifier, NextHopFlagIPConfigVerifierState);
+			}
+
+			return true;
+
+		case DestinationPrefixIPConfigVerifierState:
+			beginField(verifier, NextHopFlagIPConfigVerifierState);
+			return true;
+
+		case NextHopFlagIPConfigVerifierState:
+			if (value > 1)
+			{
+				return fail(verifier, "invalid route next hop flag");
+			}
+
+			if (value)
+			{
+				beginString(verifier, KeyLengthIPConfigVerifierState);
+			}
+
+			else
+			{
+				beginField(verifier, KeyLengthIPConfigVerifierState);
+			}
+
+			return true;
+
+		case IntegerIPConfigVerifierState:
+		case LinkPrefixIPConfigVerifierState:
+			beginField(verifier, KeyLengthIPConfigVerifierState);
+			return true;
+	}
+
+	return true;
+}
+
+bool updateIPConfigVerifier(struct IPConfigVerifier *verifier,
+                            const void *data, size_t size)
+{
+	const unsigned char *cursor = data;
+	const unsigned char *end = cursor + size;
+
+	if (verifier->error)
+	{
+		return false;
+	}
+
+	while (cursor < end)
+	{
+		size_t available = end - cursor;
+		size_t count = verifier->needed < available ?
+		               verifier->needed : available;
+
+		if (verifier->state == KeyIPConfigVerifierState)
+		{
+			memcpy(verifier->key + verifier->keyLength, cursor, count);
+			verifier->keyLength += count;
+		}
+
+		else if (verifier->state != StringIPConfigVerifierState)
+		{
+			for (size_t index = 0; index < count; index++)
+			{
+				verifier->value = verifier->value << 8 | cursor[index];
+			}
+		}
+
+		cursor += count;
+		verifier->offset += count;
+		verifier->needed -= count;
+
+		if (!verifier->needed && !completeField(verifier))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool finishIPConfigVerifier(struct IPConfigVerifier *verifier)
+{
+	if (verifier->error)
+	{
+		return false;
+	}
+
+	if (verifier->state == VersionIPConfigVerifierState)
+	{
+		return fail(verifier, "failed to read file version");
+	}
+
+	if (verifier->state == KeyLengthIPConfigVerifierState &&
+	    verifier->needed == sizeof(uint16_t))
+	{
+		if (verifier->inRecord)
+		{
+			verifier->fieldOffset = verifier->offset;
+			return fail(verifier, "missing record terminator");
+		}
+
+		return true;
+	}
+
+	if (verifier->state == StringIPConfigVerifierState ||
+	    verifier->state == KeyIPConfigVerifierState)
+	{
+		return fail(verifier, "string longer than the remaining bytes");
+	}
+
+	return fail(verifier, "truncated value");
+}
+
+/*
+ * Regular files are mapped so that skipped strings are never even read;
+ * anything else is read through a fixed buffer on the stack.
+ */
+
+bool verifyPackedIPConfigDescriptor(int descriptor,
+                                    struct IPConfigVerifier *verifier)
+{
+	unsigned char buffer[IPConfigVerifierBufferSize];
+	struct stat status;
+	ssize_t count = 0;
+
+	initializeIPConfigVerifier(verifier);
+
+	if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) &&
+	    status.st_size > 0)
+	{
+		void *mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE,
+		                     descriptor, 0);
+
+		if (mapping != MAP_FAILED)
+		{
+			bool verified = false;
+
+			madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+			verified = updateIPConfigVerifier(verifier, mapping,
+			                                  status.st_size) &&
+			           finishIPConfigVerifier(verifier);
+			munmap(mapping, status.st_size);
+
+			return verified;
+		}
+	}
+
+	while ((count = read(descriptor, buffer, sizeof buffer)) != 0)
+	{
+		if (count == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			printLibraryError("read");
+			return false;
+		}
+
+		if (!updateIPConfigVerifier(verifier, buffer, count))
+		{
+			return false;
+		}
+	}
+
+	return finishIPConfigVerifier(verifier);
+}
@@ -0,0 +1,56 @@
+#ifndef IPCONFIG_VERIFY_H
+#define IPCONFIG_VERIFY_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+#define IPConfigVerifierKeyCapacity 16
+
+enum IPConfigVerifierState
+{
+	VersionIPConfigVerifierState,
+	KeyLengthIPConfigVerifierState,
+	KeyPaddingIPConfigVerifierState,
+	KeyIPConfigVerifierState,
+	IntegerIPConfigVerifierState,
+	StringLengthIPConfigVerifierState,
+	StringPaddingIPConfigVerifierState,
+	StringIPConfigVerifierState,
+	LinkPrefixIPConfigVerifierState,
+	DestinationFlagIPConfigVerifierState,
+	DestinationPrefixIPConfigVerifierState,
+	NextHopFlagIPConfigVerifierState
+};
+
+struct IPConfigVerifier
+{
+	enum IPConfigVerifierState state;
+	enum IPConfigVerifierState next;
+	uint32_t value;
+	size_t needed;
+
+	uint32_t version;
+	char key[IPConfigVerifierKeyCapacity];
+	size_t keyLength;
+	bool inRecord;
+	size_t recordCount;
+
+	uint64_t offset;
+	uint64_t fieldOffset;
+	const char *error;
+};
+
+/*
+ * fieldOffset is where the field being read begins, and so where the first
+ * error was found once error is set.
+ */
+
+void initializeIPConfigVerifier(struct IPConfigVerifier *verifier);
+bool updateIPConfigVerifier(struct IPConfigVerifier *verifier,
+                            const void *data, size_t size);
+bool finishIPConfigVerifier(struct IPConfigVerifier *verifier);
+bool verifyPackedIPConfigDescriptor(int descriptor,
+                                    struct IPConfigVerifier *verifier);
+
+#endif
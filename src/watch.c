@@ -0,0 +1,524 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/inotify.h>
+
+#include "data.h"
+#include "diff.h"
+#include "watch.h"
+#include "ipconfig.h"
+#include "error.h"
+
+static const size_t IPConfigWatchMinimumCapacity = 16;
+
+struct IPConfigWatchRecord
+{
+	size_t offset;
+	size_t length;
+
+	struct IPConfigAttribute id;
+	bool identified;
+	uint32_t hash;
+
+	size_t next;
+	size_t pending;
+	bool matched;
+};
+
+struct IPConfigWatchSnapshot
+{
+	unsigned char *data;
+	size_t size;
+	uint32_t version;
+
+	struct IPConfigWatchRecord *records;
+	size_t recordCount;
+	size_t recordCapacity;
+};
+
+static bool isSameIdentifier(const struct IPConfigWatchRecord *left,
+                             const struct IPConfigWatchRecord *right)
+{
+	const union IPConfigValue *leftId = &left->id.value;
+	const union IPConfigValue *rightId = &right->id.value;
+
+	if (left->identified != right->identified || left->hash != right->hash)
+	{
+		return false;
+	}
+
+	if (!left->identified)
+	{
+		return true;
+	}
+
+	if (left->id.type != right->id.type)
+	{
+		return false;
+	}
+
+	if (left->id.type == IntegerIPConfigAttributeType)
+	{
+		return leftId->integer == rightId->integer;
+	}
+
+	return leftId->string.length == rightId->string.length &&
+	       !memcmp(leftId->string.data, rightId->string.data,
+	               leftId->string.length);
+}
+
+static struct IPConfigWatchRecord *appendRecord(
+	struct IPConfigWatchSnapshot *snapshot)
+{
+	struct IPConfigWatchRecord *record = NULL;
+
+	if (snapshot->recordCount == snapshot->recordCapacity)
+	{
+		size_t capacity = snapshot->recordCapacity * 2;
+
+		if (capacity < IPConfigWatchMinimumCapacity)
+		{
+			capacity = IPConfigWatchMinimumCapacity;
+		}
+
+		record = realloc(snapshot->records, capacity * sizeof *record);
+
+		if (!record)
+		{
+			printLibraryError("realloc");
+			return NULL;
+		}
+
+		snapshot->records = record;
+		snapshot->recordCapacity = capacity;
+	}
+
+	record = &snapshot->records[snapshot->recordCount++];
+	memset(record, 0, sizeof *record);
+
+	return record;
+}
+
+/*
+ * Finds where each record starts and ends and what its id is, skipping
+ * every other value by its length without decoding it.
+ */
+
+static bool scanSnapshot(struct IPConfigWatchSnapshot *snapshot)
+{
+	struct IPConfigInput input;
+
+	initializeBufferIPConfigInput(&input, snapshot->data, snapshot->size);
+
+	if (!readPackedIPConfigHeader(&input, &snapshot->version))
+	{
+		return false;
+	}
+
+	while (!isPackedInputFinished(&input))
+	{
+		struct IPConfigWatchRecord *record = appendRecord(snapshot);
+
+		if (!record)
+		{
+			return false;
+		}
+
+		record->offset = input.offset;
+
+		while (true)
+		{
+			struct IPConfigString key;
+			enum IPConfigAttributeType type = InvalidIPConfigAttributeType;
+			bool skipped = false;
+
+			if (isPackedInputFinished(&input))
+			{
+				printError("missing record terminator");
+				return false;
+			}
+
+			if (!readPackedString(&input, &key))
+			{
+				printError("failed to read attribute key");
+				return false;
+			}
+
+			type = getIPConfigAttributeType(snapshot->version, &key);
+
+			if (type == InvalidIPConfigAttributeType)
+			{
+				printError("unrecognized attribute key");
+				return false;
+			}
+
+			else if (type == TerminalIPConfigAttributeType)
+			{
+				break;
+			}
+
+			if (!record->identified &&
+			    key.length == IPConfigIdentifierKey.length &&
+			    !memcmp(key.data, IPConfigIdentifierKey.data, key.length))
+			{
+				record->identified = true;
+				record->id.type = type;
+				record->id.key = IPConfigIdentifierKey;
+				skipped = readPackedValue(&input, type, &record->id.value);
+				record->hash = hashIPConfigValue(IPConfigHashBasis,
+				                                 record->id.type,
+				                                 &record->id.value);
+			}
+
+			else
+			{
+				skipped = skipPackedValue(&input, type);
+			}
+
+			if (!skipped)
+			{
+				printError("failed to read value");
+				return false;
+			}
+		}
+
+		record->length = input.offset - record->offset;
+	}
+
+	return true;
+}
+
+static void deinitializeSnapshot(struct IPConfigWatchSnapshot *snapshot)
+{
+	free(snapshot->data);
+	free(snapshot->records);
+	memset(snapshot, 0, sizeof *snapshot);
+}
+
+static bool loadSnapshot(struct IPConfigWatchSnapshot *snapshot,
+                         const char *path)
+{
+	int descriptor = open(path, O_RDONLY);
+
+	memset(snapshot, 0, sizeof *snapshot);
+
+	if (descriptor == -1)
+	{
+		printLibraryError(path);
+		return false;
+	}
+
+	snapshot->data = readDescriptor(descriptor, &snapshot->size);
+	close(descriptor);
+
+	if (!snapshot->data || !scanSnapshot(snapshot))
+	{
+		deinitializeSnapshot(snapshot);
+		return false;
+	}
+
+	return true;
+}
+
+static bool decodeRecord(struct IPConfigDiff *diff,
+                         struct IPConfigWatchSnapshot *snapshot,
+                         struct IPConfigWatchRecord *record,
+                         struct IPConfig *config)
+{
+	struct IPConfigInput input;
+
+	initializeBufferIPConfigInput(&input, snapshot->data + record->offset,
+	                              record->length);
+	config->version = snapshot->version;
+
+	return readPackedIPConfigRecord(&input, config) ==
+	       ReadIPConfigRecordStatus &&
+	       checkIPConfigAddresses(config, diff->addressMode);
+}
+
+static bool writeRecordEvent(struct IPConfigDiff *diff, char sign,
+                             struct IPConfigWatchSnapshot *snapshot,
+                             struct IPConfigWatchRecord *record)
+{
+	fprintf(diff->stream, "%c ", sign);
+
+	if (record->identified)
+	{
+		formatUnpackedIPConfigValue(&record->id, diff->stream);
+	}
+
+	else
+	{
+		fprintf(diff->stream, "#%zu", (size_t) (record - snapshot->records));
+	}
+
+	return fputc('\n', diff->stream) != EOF;
+}
+
+/*
+ * Only records whose bytes differ from their previous version are decoded,
+ * both old and new, and compared attribute by attribute.
+ */
+
+static bool compareRecord(struct IPConfigDiff *diff,
+                          struct IPConfigWatchSnapshot *previous,
+                          struct IPConfigWatchRecord *left,
+                          struct IPConfigWatchSnapshot *current,
+                          struct IPConfigWatchRecord *right)
+{
+	struct IPConfig leftConfig = {0};
+	struct IPConfig rightConfig = {0};
+	size_t droppedCount = 0;
+	bool compared = false;
+
+	if (previous->version == current->version &&
+	    left->length == right->length &&
+	    !memcmp(previous->data + left->offset,
+	            current->data + right->offset, left->length))
+	{
+		return true;
+	}
+
+	compared = decodeRecord(diff, previous, left, &leftConfig) &&
+	           decodeRecord(diff, current, right, &rightConfig) &&
+	           (leftConfig.version == rightConfig.version ||
+	            transcodeIPConfig(&leftConfig, rightConfig.version,
+	                              &droppedCount)) &&
+	           diffIPConfigRecords(diff, &leftConfig, &rightConfig,
+	                               right - current->records);
+
+	deinitializeIPConfig(&leftConfig);
+	deinitializeIPConfig(&rightConfig);
+
+	return compared;
+}
+
+static bool compareSnapshots(struct IPConfigDiff *diff,
+                             struct IPConfigWatchSnapshot *previous,
+                             struct IPConfigWatchSnapshot *current)
+{
+	size_t slotCount = IPConfigWatchMinimumCapacity;
+	size_t *slots = NULL;
+	size_t mask = 0;
+	bool compared = true;
+
+	while (slotCount < current->recordCount * 2)
+	{
+		slotCount *= 2;
+	}
+
+	if (!(slots = calloc(slotCount, sizeof *slots)))
+	{
+		printLibraryError("calloc");
+		return false;
+	}
+
+	mask = slotCount - 1;
+
+	for (size_t index = current->recordCount; index-- > 0;)
+	{
+		struct IPConfigWatchRecord *record = &current->records[index];
+		size_t slot = record->hash & mask;
+
+		while (slots[slot] &&
+		       !isSameIdentifier(&current->records[slots[slot] - 1],
+		                         record))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		record->next = slots[slot];
+		record->pending = index + 1;
+		slots[slot] = index + 1;
+	}
+
+	for (size_t index = 0; compared && index < previous->recordCount; index++)
+	{
+		struct IPConfigWatchRecord *left = &previous->records[index];
+		struct IPConfigWatchRecord *right = NULL;
+		size_t slot = left->hash & mask;
+
+		while (slots[slot] &&
+		       !isSameIdentifier(left, &current->records[slots[slot] - 1]))
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		if (slots[slot] && current->records[slots[slot] - 1].pending)
+		{
+			struct IPConfigWatchRecord *head =
+				&current->records[slots[slot] - 1];
+
+			right = &current->records[head->pending - 1];
+			head->pending = right->next;
+			right->matched = true;
+		}
+
+		if (right)
+		{
+			compared = compareRecord(diff, previous, left, current, right);
+		}
+
+		else
+		{
+			diff->removedCount++;
+			compared = writeRecordEvent(diff, '-', previous, left);
+		}
+	}
+
+	for (size_t index = 0; compared && index < current->recordCount; index++)
+	{
+		if (!current->records[index].matched)
+		{
+			diff->addedCount++;
+			compared = writeRecordEvent(diff, '+', current,
+			                            &current->records[index]);
+		}
+	}
+
+	free(slots);
+	return compared;
+}
+
+static bool isWatchedName(const char *path, const char *name)
+{
+	const char *separator = strrchr(path, '/');
+
+	return !strcmp(separator ? separator + 1 : path, name);
+}
+
+static int addWatch(const char *path)
+{
+	const char *separator = strrchr(path, '/');
+	char *directory = NULL;
+	int descriptor = inotify_init1(IN_CLOEXEC);
+
+	if (descriptor == -1)
+	{
+		printLibraryError("inotify_init1");
+		return -1;
+	}
+
+	if (!separator)
+	{
+		directory = strdup(".");
+	}
+
+	else
+	{
+		directory = strndup(path, separator == path ? 1 : separator - path);
+	}
+
+	if (!directory)
+	{
+		printLibraryError("strdup");
+		close(descriptor);
+		return -1;
+	}
+
+	if (inotify_add_watch(descriptor, directory,
+	                      IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+	{
+		printLibraryError(directory);
+		close(descriptor);
+		descriptor = -1;
+	}
+
+	free(directory);
+	return descriptor;
+}
+
+/*
+ * The directory is watched rather than the file, since a file replaced by
+ * renaming another over it, as Android does, is a new inode that a watch
+ * on the old one would never report.  A file is looked at again once it
+ * has been closed after writing or renamed into place, and events that
+ * arrive together cause a single comparison.  A file that cannot be read
+ * or decoded is reported and the last good snapshot kept.  Only a failure
+ * to read events or to write them ends the watch.
+ */
+
+bool watchIPConfigFile(struct IPConfigDiff *diff, const char *path)
+{
+	struct IPConfigWatchSnapshot previous;
+	union
+	{
+		struct inotify_event event;
+		char data[4096];
+	} buffer;
+	int descriptor = addWatch(path);
+
+	if (descriptor == -1)
+	{
+		return false;
+	}
+
+	if (!loadSnapshot(&previous, path))
+	{
+		memset(&previous, 0, sizeof previous);
+	}
+
+	for (;;)
+	{
+		struct IPConfigWatchSnapshot current;
+		ssize_t size = read(descriptor, buffer.data, sizeof buffer.data);
+		bool changed = false;
+
+		if (size == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			printLibraryError("read");
+			break;
+		}
+
+		for (char *cursor = buffer.data; cursor < buffer.data + size;)
+		{
+			struct inotify_event *event = (struct inotify_event *) cursor;
+
+			if (event->len && isWatchedName(path, event->name))
+			{
+				changed = true;
+			}
+
+			cursor += sizeof *event + event->len;
+		}
+
+		if (!changed || !loadSnapshot(&current, path))
+		{
+			continue;
+		}
+
+		if (!compareSnapshots(diff, &previous, &current))
+		{
+			deinitializeSnapshot(&current);
+		}
+
+		else
+		{
+			deinitializeSnapshot(&previous);
+			previous = current;
+		}
+
+		if (fflush(diff->stream) == EOF)
+		{
+			printLibraryError("fflush");
+			break;
+		}
+	}
+
+	deinitializeSnapshot(&previous);
+	close(descriptor);
+
+	return false;
+}
@@ -0,0 +1,10 @@
+#ifndef IPCONFIG_WATCH_H
+#define IPCONFIG_WATCH_H
+
+#include <stdbool.h>
+
+#include "diff.h"
+
+bool watchIPConfigFile(struct IPConfigDiff *diff, const char *path);
+
+#endif
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Text and NDJSON records naming a key outside the schema, or the record
+# terminator itself, must be refused rather than packed.
+
+set -u
+
+program=${1:-./ipconfigstore}
+failures=0
+
+fail()
+{
+	echo "FAIL: $*"
+	failures=$((failures + 1))
+}
+
+for version in 1 2 3
+do
+	for key in foo eos i dnsx
+	do
+		if printf 'id: 1\n%s: bar\n' "$key" |
+		   "$program" -p "$version" > /dev/null 2>&1
+		then
+			fail "version $version: text key '$key' was accepted"
+		fi
+
+		if printf '{"%s":"bar"}\n' "$key" |
+		   "$program" -J -p "$version" > /dev/null 2>&1
+		then
+			fail "version $version: NDJSON key '$key' was accepted"
+		fi
+	done
+
+	if ! printf 'ipAssignment: DHCP\n' |
+	   "$program" -p "$version" > /dev/null
+	then
+		fail "version $version: known key was refused"
+	fi
+done
+
+if [ "$failures" -ne 0 ]
+then
+	exit 1
+fi
+
+echo "keys: ok"
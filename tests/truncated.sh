@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Packs every sample, then cuts bytes off its end: whether the file is
+# mapped, piped or verified, a record without its terminator must fail.
+
+set -u
+
+program=${1:-./ipconfigstore}
+directory=$(mktemp -d)
+failures=0
+
+trap 'rm -rf "$directory"' EXIT
+
+fail()
+{
+	echo "FAIL: $*"
+	failures=$((failures + 1))
+}
+
+for sample in samples/v*/*.conf
+do
+	version=${sample#samples/v}
+	version=${version%%/*}
+	packed=$directory/packed.bin
+	truncated=$directory/truncated.bin
+
+	if ! "$program" -p "$version" < "$sample" > "$packed"
+	then
+		fail "$sample: could not be packed"
+		continue
+	fi
+
+	if ! "$program" -u < "$packed" > /dev/null
+	then
+		fail "$sample: could not be unpacked"
+		continue
+	fi
+
+	for count in 1 2 3 5 9
+	do
+		head -c -"$count" "$packed" > "$truncated"
+
+		if "$program" -u < "$truncated" > /dev/null 2>&1
+		then
+			fail "$sample: mapped input short by $count was accepted"
+		fi
+
+		if cat "$truncated" | "$program" -u > /dev/null 2>&1
+		then
+			fail "$sample: piped input short by $count was accepted"
+		fi
+
+		if "$program" -v "$truncated" > /dev/null 2>&1
+		then
+			fail "$sample: verifier accepted input short by $count"
+		fi
+	done
+done
+
+if [ "$failures" -ne 0 ]
+then
+	exit 1
+fi
+
+echo "truncated: ok"